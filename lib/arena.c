@@ -0,0 +1,129 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "arena.h"
+#include "utils.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Size of an ordinary chunk, including its header */
+#define ARENA_CHUNK 65536
+
+/* Allocations bigger than this get a chunk to themselves */
+#define ARENA_LARGE (ARENA_CHUNK / 4)
+
+struct arena_chunk {
+  struct arena_chunk *next;
+  /* Forces the alignment of the data that follows */
+  union {
+    long double ld;
+    uintmax_t u;
+    void *p;
+  } data[];
+};
+
+#define ARENA_ALIGN (sizeof ((struct arena_chunk *)0)->data[0])
+
+static void *arena_chunk(struct arena *a, size_t size, int large) {
+  struct arena_chunk *c;
+
+  if(size > SIZE_MAX - sizeof *c)
+    fatal(0, "out of memory");
+  c = xmalloc(sizeof *c + size);
+  if(a->chunks && large) {
+    /* Keep using the current chunk for small allocations */
+    c->next = a->chunks->next;
+    a->chunks->next = c;
+  } else {
+    c->next = a->chunks;
+    a->chunks = c;
+  }
+  return c->data;
+}
+
+void *arena_alloc(struct arena *a, size_t n) {
+  char *ptr;
+
+  if(!n)
+    return NULL;
+  if(n > ARENA_LARGE)
+    return arena_chunk(a, n, 1);
+  n = (n + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+  if(n > a->left) {
+    a->left = ARENA_CHUNK - sizeof (struct arena_chunk);
+    a->ptr = arena_chunk(a, a->left, 0);
+  }
+  ptr = a->ptr;
+  a->ptr += n;
+  a->left -= n;
+  return ptr;
+}
+
+void *arena_calloc(struct arena *a, size_t n, size_t s) {
+  void *ptr;
+
+  if(n && s > SIZE_MAX / n)
+    fatal(0, "out of memory");
+  if((ptr = arena_alloc(a, n * s)))
+    memset(ptr, 0, n * s);
+  return ptr;
+}
+
+char *arena_strndup(struct arena *a, const char *s, size_t n) {
+  char *ptr;
+
+  if((size_t)(n + 1) == 0)
+    fatal(0, "out of memory");
+  ptr = arena_alloc(a, n + 1);
+  memcpy(ptr, s, n);
+  ptr[n] = 0;
+  return ptr;
+}
+
+char *arena_strdup(struct arena *a, const char *s) {
+  return arena_strndup(a, s, strlen(s));
+}
+
+void arena_merge(struct arena *dst, struct arena *src) {
+  struct arena_chunk **cp;
+
+  if(!src->chunks)
+    return;
+  if(!dst->chunks) {
+    *dst = *src;
+  } else {
+    /* Append src's chunks so that dst's current chunk stays in use */
+    for(cp = &dst->chunks->next; *cp; cp = &(*cp)->next)
+      ;
+    *cp = src->chunks;
+  }
+  memset(src, 0, sizeof *src);
+}
+
+void arena_free(struct arena *a) {
+  struct arena_chunk *c, *next;
+
+  for(c = a->chunks; c; c = next) {
+    next = c->next;
+    free(c);
+  }
+  memset(a, 0, sizeof *a);
+}
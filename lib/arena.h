@@ -0,0 +1,102 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+/** @file arena.h
+ * @brief Bump allocator
+ */
+
+#include <stddef.h>
+
+struct arena_chunk;
+
+/** @brief Arena
+ *
+ * Allocations are carved out of large chunks and are never freed
+ * individually; arena_free() releases them all at once.  An arena
+ * may be initialized by setting it to all bits 0.
+ *
+ * An arena must not be used by more than one thread at a time.
+ */
+struct arena {
+  /** @brief Chunks, most recent first */
+  struct arena_chunk *chunks;
+
+  /** @brief Next free byte in the current chunk */
+  char *ptr;
+
+  /** @brief Bytes remaining in the current chunk */
+  size_t left;
+};
+
+/** @brief Allocate memory from an arena
+ * @param a Arena
+ * @param n Number of bytes to allocate
+ * @return Pointer to new memory, or NULL if @p n is 0
+ *
+ * The memory is suitably aligned for any type and is not
+ * initialized.  It remains valid until arena_free() is called.
+ */
+void *arena_alloc(struct arena *a, size_t n);
+
+/** @brief Allocate zeroed memory for an array from an arena
+ * @param a Arena
+ * @param n Number of elements
+ * @param s Size of each element
+ * @return Pointer to new memory, or NULL if @p n or @p s is 0
+ */
+void *arena_calloc(struct arena *a, size_t n, size_t s);
+
+/** @brief Copy a string into an arena
+ * @param a Arena
+ * @param s String to copy
+ * @param n Length of string
+ * @return Copy of string
+ *
+ * The copy is 0-terminated.
+ */
+char *arena_strndup(struct arena *a, const char *s, size_t n);
+
+/** @brief Copy a string into an arena
+ * @param a Arena
+ * @param s String to copy
+ * @return Copy of string
+ */
+char *arena_strdup(struct arena *a, const char *s);
+
+/** @brief Move all allocations from one arena to another
+ * @param dst Destination arena
+ * @param src Source arena
+ *
+ * Memory allocated from @p src remains valid until @p dst is freed.
+ * @p src is left empty and may be reused.
+ */
+void arena_merge(struct arena *dst, struct arena *src);
+
+/** @brief Free an arena
+ * @param a Arena
+ *
+ * All memory allocated from @p a is released.  @p a is left empty
+ * and may be reused.
+ */
+void arena_free(struct arena *a);
+
+#endif /* ARENA_H */
@@ -0,0 +1,89 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "tasks.h"
+#include "selectors.h"
+#include "utils.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/* Benchmark for PSS retrieval, comparing smaps_rollup with a full
+ * parse of smaps.  The process creates MAPPINGS separate mappings
+ * (alternating protections stop the kernel merging them) and then
+ * measures its own PSS both ways.  The PSS from smaps comes out a
+ * little higher because it includes the buffer used to read smaps.
+ *
+ * Usage: b-smaps [MAPPINGS [ITERATIONS]] */
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Return the time taken to fetch PSS for TASK, and its value */
+static double measure(taskident task, size_t iterations, uintmax_t *pss) {
+  struct taskinfo *ti;
+  double total = 0, start;
+  size_t n;
+
+  for(n = 0; n < iterations; ++n) {
+    ti = task_enumerate(NULL, 0);
+    start = now();
+    task_prefetch(ti, &task, 1, TASK_SRC_SMAPS);
+    total += now() - start;
+    *pss = task_get_pss(ti, task);
+    task_free(ti);
+  }
+  return total / iterations;
+}
+
+int main(int argc, char **argv) {
+  size_t mappings = argc > 1 ? strtoul(argv[1], NULL, 0) : 20000;
+  size_t iterations = argc > 2 ? strtoul(argv[2], NULL, 0) : 10;
+  taskident self = { getpid(), -1 };
+  long pagesize = sysconf(_SC_PAGESIZE);
+  uintmax_t pss_rollup, pss_full;
+  double trollup, tfull;
+  char *base;
+  size_t n;
+
+  if((base = mmap(NULL, mappings * pagesize, PROT_READ|PROT_WRITE,
+                   MAP_PRIVATE|MAP_ANONYMOUS, -1, 0)) == MAP_FAILED)
+    fatal(errno, "mmap");
+  for(n = 0; n < mappings; ++n) {
+    base[n * pagesize] = 1;
+    if(n % 2 && mprotect(base + n * pagesize, pagesize, PROT_READ) < 0)
+      fatal(errno, "mprotect");
+  }
+  select_add(select_all, NULL, 0);
+  task_smaps_rollup = 1;
+  trollup = measure(self, iterations, &pss_rollup);
+  task_smaps_rollup = 0;
+  tfull = measure(self, iterations, &pss_full);
+  printf("%10s %14s %14s\n", "mappings", "rollup us/op", "smaps us/op");
+  printf("%10zu %14.1f %14.1f\n", mappings, trollup * 1e6, tfull * 1e6);
+  printf("%10s %14ju %14ju\n", "PSS KB", pss_rollup / 1024, pss_full / 1024);
+  return 0;
+}
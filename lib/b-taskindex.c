@@ -0,0 +1,104 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "taskindex.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Benchmark for task lookup.  For comparison, CHAINED emulates the
+ * fixed 256-entry chained hash that used to be in struct taskinfo.
+ *
+ * Usage: b-taskindex [MAXTASKS] */
+
+#define CHAINED_SIZE 256
+
+struct chained {
+  size_t heads[CHAINED_SIZE];
+  size_t *links;
+  taskident *ids;
+};
+
+static size_t chained_find(const struct chained *c, taskident id) {
+  size_t n = c->heads[(size_t)(id.pid + id.tid) % CHAINED_SIZE];
+  while(n != SIZE_MAX
+        && (c->ids[n].pid != id.pid || c->ids[n].tid != id.tid))
+    n = c->links[n];
+  return n;
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+  size_t maxtasks = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000000;
+  size_t ntasks, n, h, lookups, found;
+  struct taskindex ix[1];
+  struct chained c[1];
+  taskident *ids;
+  double start, tindex, tchained;
+
+  printf("%10s %14s %14s\n", "tasks", "index ns/op", "chained ns/op");
+  for(ntasks = 1000; ntasks <= maxtasks; ntasks *= 10) {
+    /* Processes with 4 threads each, as a scan of /proc would give */
+    ids = xrecalloc(NULL, ntasks, sizeof *ids);
+    for(n = 0; n < ntasks; ++n) {
+      ids[n].pid = 1000 + n / 5;
+      ids[n].tid = n % 5 ? ids[n].pid + (pid_t)(n % 5) - 1 : -1;
+    }
+    taskindex_init(ix, ntasks);
+    for(n = 0; n < ntasks; ++n)
+      taskindex_insert(ix, ids[n], n);
+    c->links = xrecalloc(NULL, ntasks, sizeof *c->links);
+    c->ids = ids;
+    for(h = 0; h < CHAINED_SIZE; ++h)
+      c->heads[h] = SIZE_MAX;
+    for(n = 0; n < ntasks; ++n) {
+      h = (size_t)(ids[n].pid + ids[n].tid) % CHAINED_SIZE;
+      c->links[n] = c->heads[h];
+      c->heads[h] = n;
+    }
+    /* Look up a pseudo-random sequence of tasks */
+    lookups = 4000000;
+    found = 0;
+    start = now();
+    for(n = 0; n < lookups; ++n)
+      found += taskindex_find(ix, ids[(n * 2654435761u) % ntasks]) != SIZE_MAX;
+    tindex = now() - start;
+    /* The chained table is too slow to do as many lookups */
+    lookups = ntasks > 10000 ? 400000 : lookups;
+    start = now();
+    for(n = 0; n < lookups; ++n)
+      found += chained_find(c, ids[(n * 2654435761u) % ntasks]) != SIZE_MAX;
+    tchained = now() - start;
+    printf("%10zu %14.1f %14.1f\n", ntasks,
+           tindex * 1e9 / 4000000, tchained * 1e9 / lookups);
+    if(!found)
+      return 1;
+    taskindex_free(ix);
+    free(c->links);
+    free(ids);
+  }
+  return 0;
+}
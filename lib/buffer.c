@@ -49,6 +49,12 @@ void buffer_append_n(struct buffer *b, const char *s, size_t n) {
   b->pos += n;
 }
 
+void buffer_pad(struct buffer *b, int c, size_t n) {
+  buffer_need(b, b->pos + n);
+  memset(b->base + b->pos, c, n);
+  b->pos += n;
+}
+
 int buffer_printf(struct buffer *b, const char *fmt, ...) {
   va_list ap;
   int n;
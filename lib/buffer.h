@@ -60,6 +60,13 @@ void buffer_putc_outline(struct buffer *b, int c);
  */
 void buffer_append_n(struct buffer *b, const char *s, size_t n);
 
+/** @brief Append copies of a character to a string buffer
+ * @param b Pointer to string buffer
+ * @param c Character to append
+ * @param n Number of copies
+ */
+void buffer_pad(struct buffer *b, int c, size_t n);
+
 /** @brief Append a character to a string buffer
  * @param b Pointer to string buffer
  * @param c Character to append
@@ -26,12 +26,23 @@
 #include "format.h"
 #include "general.h"
 
+/* Append COUNT copies of C to BUFFER at *POS, leaving room for a
+ * terminator */
+static void bytes_put(char buffer[], size_t bufsize, size_t *pos,
+                      int c, size_t count) {
+  while(count-- > 0 && *pos + 1 < bufsize)
+    buffer[(*pos)++] = c;
+}
+
 char *bytes(uintmax_t n,
             int fieldwidth,
             int ch,
             char buffer[],
             size_t bufsize,
             unsigned cutoff) {
+  char digits[FORMAT_DIGITS_MAX], *end = digits + sizeof digits, *start;
+  size_t len, pad, pos;
+
   if(!ch) {
     if(!cutoff)
       cutoff = 1;
@@ -56,10 +67,24 @@ char *bytes(uintmax_t n,
   case 'P': n /= PETABYTE; break;
   case 'p': n /= sysconf(_SC_PAGESIZE); break;
   }
+  /* Lay out as snprintf() would with "%*ju%c" or "%*ju", but without
+   * the overhead of parsing a format string */
+  if(ch < 0)
+    --fieldwidth;
+  start = format_digits(end, n, 10, 0);
+  len = end - start;
+  pad = (size_t)abs(fieldwidth) > len ? (size_t)abs(fieldwidth) - len : 0;
+  pos = 0;
+  if(fieldwidth > 0)
+    bytes_put(buffer, bufsize, &pos, ' ', pad);
+  while(start < end)
+    bytes_put(buffer, bufsize, &pos, *start++, 1);
+  if(fieldwidth < 0)
+    bytes_put(buffer, bufsize, &pos, ' ', pad);
   if(ch < 0)
-    snprintf(buffer, bufsize, "%*ju%c", fieldwidth - 1, n, -ch);
-  else
-    snprintf(buffer, bufsize, "%*ju", fieldwidth, n);
+    bytes_put(buffer, bufsize, &pos, -ch, 1);
+  if(bufsize)
+    buffer[pos] = 0;
   return buffer;
 }
 
@@ -50,6 +50,20 @@ int compare_task(const void *av, const void *bv) {
 } while(0)
 
 
+int qlparse(const char *a, uintmax_t *value) {
+  uintmax_t ad;
+  char *ea;
+  if(!isdigit((unsigned char)*a))
+    return 0;
+  GET_VALUE(a);
+  if(*ea)
+    return 0;
+  *value = ad;
+  return 1;
+string_compare:
+  return 0;
+}
+
 int qlcompare(const char *a, const char *b) {
   uintmax_t ad, bd;
   char *ea, *eb;
@@ -24,6 +24,8 @@
  * @brief Comparison utilities
  */
 
+#include <stdint.h>
+
 /** @brief Most recent task enumeration */
 extern struct taskinfo *global_taskinfo;
 
@@ -40,4 +42,15 @@ int compare_task(const void *av, const void *bv);
  */
 int qlcompare(const char *a, const char *b);
 
+/** @brief Parse a number as qlcompare() would
+ * @param a String to parse
+ * @param value Where to store value
+ * @return Nonzero if @p a is a single number
+ *
+ * If this succeeds then comparing @p a with the decimal
+ * representation of a nonnegative integer using qlcompare() is the
+ * same as comparing @p value with that integer.
+ */
+int qlparse(const char *a, uintmax_t *value);
+
 #endif /* COMPARE_H */
@@ -0,0 +1,170 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "events.h"
+#include "utils.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#if HAVE_LINUX_CN_PROC_H
+# include <linux/netlink.h>
+# include <linux/connector.h>
+# include <linux/cn_proc.h>
+#endif
+
+#if HAVE_LINUX_CN_PROC_H
+
+/* How long to wait for the kernel to acknowledge a subscription */
+#define EVENTS_ACK_TIMEOUT 1000 /*ms*/
+
+/* Sufficient for a batch of event messages */
+#define EVENTS_BUFSIZE 16384
+
+int events_open(void) {
+  struct sockaddr_nl sa;
+  struct {
+    struct nlmsghdr nl;
+    struct cn_msg cn;
+    enum proc_cn_mcast_op op;
+  } attribute((packed)) req;
+  char buffer[EVENTS_BUFSIZE];
+  struct nlmsghdr *nl;
+  struct cn_msg *cn;
+  struct proc_event *ev;
+  struct pollfd pfd;
+  ssize_t n;
+  int fd, save_errno;
+
+  if((fd = socket(PF_NETLINK, SOCK_DGRAM|SOCK_NONBLOCK|SOCK_CLOEXEC,
+                  NETLINK_CONNECTOR)) < 0)
+    return -1;
+  memset(&sa, 0, sizeof sa);
+  sa.nl_family = AF_NETLINK;
+  sa.nl_groups = CN_IDX_PROC;
+  if(bind(fd, (struct sockaddr *)&sa, sizeof sa) < 0)
+    goto error;
+  memset(&req, 0, sizeof req);
+  req.nl.nlmsg_len = sizeof req;
+  req.nl.nlmsg_type = NLMSG_DONE;
+  req.cn.id.idx = CN_IDX_PROC;
+  req.cn.id.val = CN_VAL_PROC;
+  req.cn.len = sizeof req.op;
+  req.op = PROC_CN_MCAST_LISTEN;
+  if(send(fd, &req, sizeof req, 0) < 0)
+    goto error;
+  /* Permission failures are only reported in the acknowledgement */
+  for(;;) {
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    if(poll(&pfd, 1, EVENTS_ACK_TIMEOUT) <= 0) {
+      errno = ETIMEDOUT;
+      goto error;
+    }
+    if((n = recv(fd, buffer, sizeof buffer, 0)) < 0) {
+      if(errno == EINTR || errno == EAGAIN)
+        continue;
+      goto error;
+    }
+    for(nl = (struct nlmsghdr *)buffer;
+        NLMSG_OK(nl, (size_t)n);
+        nl = NLMSG_NEXT(nl, n)) {
+      cn = NLMSG_DATA(nl);
+      ev = (struct proc_event *)cn->data;
+      if(ev->what == PROC_EVENT_NONE) {
+        if(ev->event_data.ack.err) {
+          errno = ev->event_data.ack.err;
+          goto error;
+        }
+        return fd;
+      }
+    }
+  }
+error:
+  save_errno = errno;
+  close(fd);
+  errno = save_errno;
+  return -1;
+}
+
+int events_read(int fd, events_callback *callback, void *u) {
+  char buffer[EVENTS_BUFSIZE];
+  struct nlmsghdr *nl;
+  struct cn_msg *cn;
+  struct proc_event *ev;
+  ssize_t n;
+  int lost = 0;
+
+  for(;;) {
+    if((n = recv(fd, buffer, sizeof buffer, 0)) < 0) {
+      if(errno == EINTR)
+        continue;
+      if(errno == EAGAIN)
+        break;
+      if(errno == ENOBUFS) {
+        /* Keep reading so that the socket is drained */
+        lost = 1;
+        continue;
+      }
+      fatal(errno, "recv");
+    }
+    for(nl = (struct nlmsghdr *)buffer;
+        NLMSG_OK(nl, (size_t)n);
+        nl = NLMSG_NEXT(nl, n)) {
+      if(nl->nlmsg_type == NLMSG_ERROR || nl->nlmsg_type == NLMSG_NOOP)
+        continue;
+      cn = NLMSG_DATA(nl);
+      ev = (struct proc_event *)cn->data;
+      switch(ev->what) {
+      case PROC_EVENT_FORK:
+        callback(u, EVENT_FORK, ev->event_data.fork.child_tgid,
+                 ev->event_data.fork.child_pid);
+        break;
+      case PROC_EVENT_EXEC:
+        callback(u, EVENT_EXEC, ev->event_data.exec.process_tgid,
+                 ev->event_data.exec.process_pid);
+        break;
+      case PROC_EVENT_EXIT:
+        callback(u, EVENT_EXIT, ev->event_data.exit.process_tgid,
+                 ev->event_data.exit.process_pid);
+        break;
+      default:
+        break;
+      }
+    }
+  }
+  return lost ? -1 : 0;
+}
+
+#else
+
+int events_open(void) {
+  errno = ENOSYS;
+  return -1;
+}
+
+int events_read(int attribute((unused)) fd,
+                events_callback attribute((unused)) *callback,
+                void attribute((unused)) *u) {
+  return -1;
+}
+
+#endif
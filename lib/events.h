@@ -0,0 +1,70 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#ifndef EVENTS_H
+#define EVENTS_H
+
+/** @file events.h
+ * @brief Process event notifications
+ *
+ * This is a thin wrapper around the Linux proc connector.
+ */
+
+#include <sys/types.h>
+
+/** @brief A process or thread was created */
+#define EVENT_FORK 1
+
+/** @brief A process called exec */
+#define EVENT_EXEC 2
+
+/** @brief A process or thread exited */
+#define EVENT_EXIT 3
+
+/** @brief Signature of an event callback
+ * @param u Context pointer passed to events_read()
+ * @param what @ref EVENT_FORK, @ref EVENT_EXEC or @ref EVENT_EXIT
+ * @param pid Process ID
+ * @param tid Thread ID
+ *
+ * For @ref EVENT_FORK, @p pid and @p tid identify the new task.
+ */
+typedef void events_callback(void *u, int what, pid_t pid, pid_t tid);
+
+/** @brief Subscribe to process events
+ * @return File descriptor or -1 on error
+ *
+ * The usual reason for failure is lack of @c CAP_NET_ADMIN.  The
+ * file descriptor is nonblocking.
+ */
+int events_open(void);
+
+/** @brief Read pending process events
+ * @param fd File descriptor from events_open()
+ * @param callback Function to call for each event
+ * @param u Context pointer for @p callback
+ * @return 0 on success, -1 if events were lost
+ *
+ * Returns when there are no more events to read.  If events were
+ * lost, the caller must find out the current state of the system by
+ * some other means.
+ */
+int events_read(int fd, events_callback *callback, void *u);
+
+#endif /* EVENTS_H */
@@ -0,0 +1,311 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "selectors.h"
+#include "utils.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Filter expressions are compiled to a tree.  AND and OR nodes have
+ * any number of operands, which are reordered by cost so that cheap
+ * tests are made first and expensive ones can often be skipped. */
+
+enum filter_type {
+  FILTER_TERM,
+  FILTER_NOT,
+  FILTER_AND,
+  FILTER_OR,
+};
+
+struct filter {
+  enum filter_type type;
+  unsigned cost;                /* see filter_cost() */
+  select_function *sfn;         /* FILTER_TERM only */
+  union arg *args;
+  size_t nargs;
+  struct filter **operands;     /* other types */
+  size_t noperands;
+};
+
+/* The combined filter, or NULL */
+static struct filter *filter;
+
+/* Terms at or below this cost have their sources prefetched for
+ * every task; above it, they are only read for tasks that get that
+ * far through the filter. */
+#define FILTER_PREFETCH_COST 2
+
+/* Rank the cost of reading SOURCES for one task */
+static unsigned filter_cost(unsigned sources) {
+  if(sources & TASK_SRC_SMAPS)
+    return 4;
+  if(sources & TASK_SRC_IO)
+    return 3;
+  if(sources & (TASK_SRC_STATUS|TASK_SRC_CMDLINE|TASK_SRC_OOM))
+    return 2;
+  if(sources & TASK_SRC_STAT)
+    return 1;
+  return 0;
+}
+
+// ----------------------------------------------------------------------------
+
+struct filter_parser {
+  const char *expr;             /* whole expression, for errors */
+  const char *ptr;              /* next unread character */
+  char *token;                  /* current token, or NULL at end */
+  int quoted;                   /* nonzero if token contained quotes */
+};
+
+/* Read the next token.  Parentheses are tokens in their own right;
+ * anything else runs up to whitespace or a parenthesis, with quotes
+ * protecting those characters. */
+static void filter_next(struct filter_parser *p) {
+  struct buffer b[1];
+  int q = 0;
+
+  free(p->token);
+  p->token = NULL;
+  p->quoted = 0;
+  while(isspace((unsigned char)*p->ptr))
+    ++p->ptr;
+  if(!*p->ptr)
+    return;
+  buffer_init(b);
+  if(*p->ptr == '(' || *p->ptr == ')')
+    buffer_putc(b, *p->ptr++);
+  else {
+    while(*p->ptr) {
+      if(q) {
+        if(*p->ptr == q)
+          q = 0;
+        else
+          buffer_putc(b, *p->ptr);
+      } else if(*p->ptr == '\'' || *p->ptr == '"') {
+        q = *p->ptr;
+        p->quoted = 1;
+      } else if(isspace((unsigned char)*p->ptr)
+                || *p->ptr == '(' || *p->ptr == ')')
+        break;
+      else
+        buffer_putc(b, *p->ptr);
+      ++p->ptr;
+    }
+    if(q)
+      fatal(0, "unterminated quote in filter expression '%s'", p->expr);
+  }
+  buffer_terminate(b);
+  p->token = b->base;
+}
+
+/* Return nonzero if the current token is the keyword WORD */
+static int filter_keyword(const struct filter_parser *p, const char *word) {
+  return p->token && !p->quoted && !strcmp(p->token, word);
+}
+
+static struct filter *filter_new(enum filter_type type) {
+  struct filter *f = xmalloc(sizeof *f);
+  memset(f, 0, sizeof *f);
+  f->type = type;
+  return f;
+}
+
+/* Add OPERAND to F, merging nested nodes of the same type */
+static void filter_operand(struct filter *f, struct filter *operand) {
+  size_t n;
+  if(operand->type == f->type) {
+    for(n = 0; n < operand->noperands; ++n)
+      filter_operand(f, operand->operands[n]);
+    free(operand->operands);
+    free(operand);
+    return;
+  }
+  f->operands = xrecalloc(f->operands, f->noperands + 1,
+                          sizeof *f->operands);
+  f->operands[f->noperands++] = operand;
+  if(operand->cost > f->cost)
+    f->cost = operand->cost;
+}
+
+/* Put F's operands into cost order.  The sort is stable, so
+ * otherwise the order they were written in is kept. */
+static void filter_order(struct filter *f) {
+  struct filter *operand;
+  size_t n, m;
+  for(n = 1; n < f->noperands; ++n) {
+    operand = f->operands[n];
+    for(m = n; m > 0 && f->operands[m - 1]->cost > operand->cost; --m)
+      f->operands[m] = f->operands[m - 1];
+    f->operands[m] = operand;
+  }
+}
+
+static struct filter *filter_or(struct filter_parser *p);
+
+static struct filter *filter_primary(struct filter_parser *p) {
+  struct filter *f, *g;
+  if(!p->token)
+    fatal(0, "filter expression '%s' ends unexpectedly", p->expr);
+  if(filter_keyword(p, "not")) {
+    filter_next(p);
+    g = filter_primary(p);
+    if(g->type == FILTER_NOT) {
+      /* not not X is just X */
+      f = g->operands[0];
+      free(g->operands);
+      free(g);
+      return f;
+    }
+    f = filter_new(FILTER_NOT);
+    f->operands = xmalloc(sizeof *f->operands);
+    f->operands[0] = g;
+    f->noperands = 1;
+    f->cost = g->cost;
+    return f;
+  }
+  if(filter_keyword(p, "(")) {
+    filter_next(p);
+    f = filter_or(p);
+    if(!filter_keyword(p, ")"))
+      fatal(0, "missing ')' in filter expression '%s'", p->expr);
+    filter_next(p);
+    return f;
+  }
+  if(filter_keyword(p, ")") || filter_keyword(p, "and")
+     || filter_keyword(p, "or"))
+    fatal(0, "unexpected '%s' in filter expression '%s'",
+          p->token, p->expr);
+  f = filter_new(FILTER_TERM);
+  f->sfn = select_match_compile(p->token, &f->args, &f->nargs);
+  f->cost = filter_cost(select_function_sources(f->sfn, f->args, f->nargs));
+  filter_next(p);
+  return f;
+}
+
+static struct filter *filter_and(struct filter_parser *p) {
+  struct filter *f = filter_primary(p), *g;
+  if(!filter_keyword(p, "and"))
+    return f;
+  g = filter_new(FILTER_AND);
+  filter_operand(g, f);
+  while(filter_keyword(p, "and")) {
+    filter_next(p);
+    filter_operand(g, filter_primary(p));
+  }
+  filter_order(g);
+  return g;
+}
+
+static struct filter *filter_or(struct filter_parser *p) {
+  struct filter *f = filter_and(p), *g;
+  if(!filter_keyword(p, "or"))
+    return f;
+  g = filter_new(FILTER_OR);
+  filter_operand(g, f);
+  while(filter_keyword(p, "or")) {
+    filter_next(p);
+    filter_operand(g, filter_and(p));
+  }
+  filter_order(g);
+  return g;
+}
+
+// ----------------------------------------------------------------------------
+
+static int filter_eval(const struct filter *f,
+                       struct taskinfo *ti, taskident task) {
+  size_t n;
+  switch(f->type) {
+  case FILTER_TERM:
+    return !!f->sfn(ti, task, f->args, f->nargs);
+  case FILTER_NOT:
+    return !filter_eval(f->operands[0], ti, task);
+  case FILTER_AND:
+    for(n = 0; n < f->noperands; ++n)
+      if(!filter_eval(f->operands[n], ti, task))
+        return 0;
+    return 1;
+  case FILTER_OR:
+    for(n = 0; n < f->noperands; ++n)
+      if(filter_eval(f->operands[n], ti, task))
+        return 1;
+    return 0;
+  }
+  abort();
+}
+
+static unsigned filter_sources_below(const struct filter *f) {
+  unsigned sources = 0;
+  size_t n;
+  if(f->type == FILTER_TERM) {
+    if(f->cost <= FILTER_PREFETCH_COST)
+      sources = select_function_sources(f->sfn, f->args, f->nargs);
+  } else
+    for(n = 0; n < f->noperands; ++n)
+      sources |= filter_sources_below(f->operands[n]);
+  return sources;
+}
+
+static void filter_free(struct filter *f) {
+  size_t n;
+  if(f->type == FILTER_TERM)
+    select_match_free(f->sfn, f->args, f->nargs);
+  for(n = 0; n < f->noperands; ++n)
+    filter_free(f->operands[n]);
+  free(f->operands);
+  free(f);
+}
+
+void select_filter(const char *expr) {
+  struct filter_parser p[1];
+  struct filter *f, *g;
+
+  p->expr = p->ptr = expr;
+  p->token = NULL;
+  filter_next(p);
+  f = filter_or(p);
+  if(p->token)
+    fatal(0, "unexpected '%s' in filter expression '%s'", p->token, expr);
+  /* Multiple filters must all be satisfied */
+  if(filter) {
+    g = filter_new(FILTER_AND);
+    filter_operand(g, filter);
+    filter_operand(g, f);
+    filter_order(g);
+    f = g;
+  }
+  filter = f;
+}
+
+void select_filter_clear(void) {
+  if(filter) {
+    filter_free(filter);
+    filter = NULL;
+  }
+}
+
+int select_filter_test(struct taskinfo *ti, taskident task) {
+  return !filter || filter_eval(filter, ti, task);
+}
+
+unsigned select_filter_sources(void) {
+  return filter ? filter_sources_below(filter) : 0;
+}
@@ -24,6 +24,7 @@
 #include "utils.h"
 #include "parse.h"
 #include "user.h"
+#include "sort.h"
 #include <string.h>
 #include <inttypes.h>
 #include <stdio.h>
@@ -35,6 +36,7 @@
 #include <linux/sched.h>        /* we want the kernel's SCHED_... not glibc's */
 #include <signal.h>
 #include <limits.h>
+#include <math.h>
 
 #ifndef SCHED_RESET_ON_FORK
 /* Not in older kernels, but we'd like binaries built on old systems
@@ -74,9 +76,11 @@ struct propinfo {
     const char *(*fetch_string)(struct taskinfo *, taskident);
     void (*fetch_sigset)(struct taskinfo *, taskident, sigset_t *);
   } fetch;
+  unsigned sources;             /* TASK_SRC_... bits needed */
 };
 #define PROP_TEXT 1
 #define PROP_NUMERIC 2
+#define PROP_GLOBAL 4           /* depends on other tasks */
 
 #define ANTIWOBBLE 16           /* size of anti-wobble ring buffer */
 
@@ -93,6 +97,10 @@ struct column {
 static size_t ncolumns;
 static struct column *columns;
 
+/* Space to render a single value in, reused throughout a report so
+ * that rendering cells doesn't allocate */
+static struct buffer cell[1];
+
 struct order {
   const struct propinfo *prop;
   int sign;
@@ -111,7 +119,60 @@ void format_syntax(enum format_syntax s) {
 
 // ----------------------------------------------------------------------------
 
+/* Pairs of decimal digits, so that two can be converted at once */
+static const char digit_pairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+char *format_digits(char *end, uintmax_t n, int base, int upper) {
+  const char *hex = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+  unsigned d;
+
+  switch(base) {
+  case 8:
+    do {
+      *--end = '0' + (n & 7);
+      n >>= 3;
+    } while(n);
+    break;
+  case 16:
+    do {
+      *--end = hex[n & 15];
+      n >>= 4;
+    } while(n);
+    break;
+  default:
+    while(n >= 100) {
+      d = n % 100;
+      n /= 100;
+      end -= 2;
+      memcpy(end, digit_pairs + 2 * d, 2);
+    }
+    if(n >= 10) {
+      end -= 2;
+      memcpy(end, digit_pairs + 2 * n, 2);
+    } else
+      *--end = '0' + n;
+    break;
+  }
+  return end;
+}
+
+/* Append a number from 0 to 99 as two digits */
+static void format_2digits(struct buffer *b, int n) {
+  buffer_append_n(b, digit_pairs + 2 * n, 2);
+}
+
 void format_integer(intmax_t im, struct buffer *b, int base) {
+  char digits[FORMAT_DIGITS_MAX], *end = digits + sizeof digits, *start;
   // For CSV output force decimal
   if(syntax == syntax_csv) {
     switch(base) {
@@ -119,26 +180,39 @@ void format_integer(intmax_t im, struct buffer *b, int base) {
     }
   }
   switch(base) {
-  case 'o': buffer_printf(b, "%jo", im); break;
-  case 'x': buffer_printf(b, "%jx", im); break;
-  case 'X': buffer_printf(b, "%jX", im); break;
-  case 'u': buffer_printf(b, "%ju", im); break;
-  default: buffer_printf(b, "%jd", im); break;
+  case 'o': start = format_digits(end, im, 8, 0); break;
+  case 'x': start = format_digits(end, im, 16, 0); break;
+  case 'X': start = format_digits(end, im, 16, 1); break;
+  case 'u': start = format_digits(end, im, 10, 0); break;
+  default:
+    if(im < 0) {
+      start = format_digits(end, -(uintmax_t)im, 10, 0);
+      *--start = '-';
+    } else
+      start = format_digits(end, im, 10, 0);
+    break;
   }
+  buffer_append_n(b, start, end - start);
 }
 
 void format_addr(uintmax_t im, struct buffer *b) {
+  char digits[FORMAT_DIGITS_MAX], *end = digits + sizeof digits, *start;
+  size_t width;
   // For CSV output fore decimal
   if(syntax == syntax_csv)
-    buffer_printf(b, "%ju", im);
+    start = format_digits(end, im, 10, 0);
   else {
     if(im > 0xFFFFFFFFFFFFLL)
-      buffer_printf(b, "%016jx", im);
+      width = 16;
     else if(im > 0xFFFFFFFF)
-      buffer_printf(b, "%012jx", im);
+      width = 12;
     else
-      buffer_printf(b, "%08jx", im);
+      width = 8;
+    start = format_digits(end, im, 16, 0);
+    while((size_t)(end - start) < width)
+      *--start = '0';
   }
+  buffer_append_n(b, start, end - start);
 }
 
 void format_usergroup(intmax_t id, struct buffer *b, size_t columnsize,
@@ -188,6 +262,85 @@ void format_interval(long seconds, struct buffer *b,
   }
 }
 
+/* Number of days cached by format_localtime() */
+#define DAY_CACHE_SLOTS 16
+
+/* Cache of the local time at the start of a day.  Timestamps within
+ * that day are converted by arithmetic rather than by calling
+ * localtime_r(), which is costly when there are many of them. */
+struct day_cache {
+  int valid;
+  time_t start;                 /* midnight */
+  struct tm tm;                 /* local time at midnight */
+};
+
+/* Cached days, each in the slot for the UTC day its midnight falls
+ * in */
+static struct day_cache day_caches[DAY_CACHE_SLOTS];
+
+/* The most recent current time converted by format_time() */
+static struct {
+  int valid;
+  time_t now;
+  struct tm tm;
+} now_cache;
+
+/* Return the cached day containing WHEN, or a null pointer */
+static const struct day_cache *day_cache_find(time_t when) {
+  const struct day_cache *dc;
+  int n;
+  /* The day's midnight is on the same UTC day as WHEN or the one
+   * before */
+  for(n = 0; n < 2; ++n) {
+    dc = &day_caches[(uintmax_t)(when / 86400 - n) % DAY_CACHE_SLOTS];
+    if(dc->valid && when >= dc->start && when - dc->start < 86400)
+      return dc;
+  }
+  return NULL;
+}
+
+/* Convert WHEN to local time.  Only days that run from midnight to
+ * midnight without a change of UTC offset are cached. */
+static void format_localtime(time_t when, struct tm *tm) {
+  const struct day_cache *dc;
+  struct day_cache *slot;
+  time_t start, last;
+  struct tm start_tm, last_tm;
+  long s;
+
+  if((dc = day_cache_find(when))) {
+    s = when - dc->start;
+    *tm = dc->tm;
+    tm->tm_hour = s / 3600;
+    tm->tm_min = s / 60 % 60;
+    tm->tm_sec = s % 60;
+    return;
+  }
+  localtime_r(&when, tm);
+  start = when - (tm->tm_hour * 3600 + tm->tm_min * 60 + tm->tm_sec);
+  last = start + 86399;
+  localtime_r(&start, &start_tm);
+  localtime_r(&last, &last_tm);
+  if(start_tm.tm_hour == 0
+     && start_tm.tm_min == 0
+     && start_tm.tm_sec == 0
+     && start_tm.tm_mday == tm->tm_mday
+     && last_tm.tm_hour == 23
+     && last_tm.tm_min == 59
+     && last_tm.tm_sec == 59
+     && last_tm.tm_mday == tm->tm_mday) {
+    slot = &day_caches[(uintmax_t)(start / 86400) % DAY_CACHE_SLOTS];
+    slot->valid = 1;
+    slot->start = start;
+    slot->tm = start_tm;
+  }
+}
+
+/* Append the year as %Y would */
+static void format_year(struct buffer *b, const struct tm *tm) {
+  format_integer(tm->tm_year + (intmax_t)1900, b, 'd');
+}
+
 void format_time(time_t when, struct buffer *b, size_t columnsize,
                  const char *format, unsigned flags) {
   time_t now;
@@ -197,24 +350,55 @@ void format_time(time_t when, struct buffer *b, size_t columnsize,
     format_integer(when, b, 'd');
     return;
   }
+  /* The current time is the same for every row of a report */
   now = timespec_now(NULL);
-  localtime_r(&when, &when_tm);
-  localtime_r(&now, &now_tm);
+  if(!now_cache.valid || now_cache.now != now) {
+    localtime_r(&now, &now_cache.tm);
+    now_cache.now = now;
+    now_cache.valid = 1;
+  }
+  now_tm = now_cache.tm;
+  format_localtime(when, &when_tm);
+  /* The fixed layouts are built directly, rather than by strftime() */
   if(format)
     buffer_strftime(b, format, &when_tm);
-  else if(columnsize != SIZE_MAX && columnsize >= 19)
-    buffer_strftime(b, "%Y-%m-%dT%H:%M:%S", &when_tm);
-  else if(now_tm.tm_year == when_tm.tm_year
-          && now_tm.tm_mon == when_tm.tm_mon
-          && now_tm.tm_mday == when_tm.tm_mday) {
-    if(columnsize < 8)
-      buffer_strftime(b, "%H:%M", &when_tm);
-    else
-      buffer_strftime(b, "%H:%M:%S", &when_tm);
-  } else if(columnsize < 10 && now_tm.tm_year == when_tm.tm_year)
-    buffer_strftime(b, "%m-%d", &when_tm);
-  else
-    buffer_strftime(b, "%Y-%m-%d", &when_tm);
+  else if(columnsize != SIZE_MAX && columnsize >= 19) {
+    /* %Y-%m-%dT%H:%M:%S */
+    format_year(b, &when_tm);
+    buffer_putc(b, '-');
+    format_2digits(b, when_tm.tm_mon + 1);
+    buffer_putc(b, '-');
+    format_2digits(b, when_tm.tm_mday);
+    buffer_putc(b, 'T');
+    format_2digits(b, when_tm.tm_hour);
+    buffer_putc(b, ':');
+    format_2digits(b, when_tm.tm_min);
+    buffer_putc(b, ':');
+    format_2digits(b, when_tm.tm_sec);
+  } else if(now_tm.tm_year == when_tm.tm_year
+            && now_tm.tm_mon == when_tm.tm_mon
+            && now_tm.tm_mday == when_tm.tm_mday) {
+    /* %H:%M or %H:%M:%S */
+    format_2digits(b, when_tm.tm_hour);
+    buffer_putc(b, ':');
+    format_2digits(b, when_tm.tm_min);
+    if(columnsize >= 8) {
+      buffer_putc(b, ':');
+      format_2digits(b, when_tm.tm_sec);
+    }
+  } else if(columnsize < 10 && now_tm.tm_year == when_tm.tm_year) {
+    /* %m-%d */
+    format_2digits(b, when_tm.tm_mon + 1);
+    buffer_putc(b, '-');
+    format_2digits(b, when_tm.tm_mday);
+  } else {
+    /* %Y-%m-%d */
+    format_year(b, &when_tm);
+    buffer_putc(b, '-');
+    format_2digits(b, when_tm.tm_mon + 1);
+    buffer_putc(b, '-');
+    format_2digits(b, when_tm.tm_mday);
+  }
 }
 
 void format_sigset(const sigset_t *ssp, struct buffer *b, size_t columnsize,
@@ -484,10 +668,9 @@ static void property_command_general(const struct column *col,
   }
   /* "A process that has exited and has a parent, but has not yet been
    * waited for by the parent, shall be marked defunct." */
-  if(task_get_state(ti, task) != 'Z')
-    buffer_append(b, comm);
-  else
-    buffer_printf(b, "%s <defunct>", comm);
+  buffer_append(b, comm);
+  if(task_get_state(ti, task) == 'Z')
+    buffer_append(b, " <defunct>");
   /* Truncate to column size */
   if(b->pos - start > columnsize)
     b->pos = start + columnsize;
@@ -678,8 +861,8 @@ static int compare_gids(const struct propinfo *prop, struct taskinfo *ti,
 
 static int compare_group(const struct propinfo *prop, struct taskinfo *ti,
                        taskident a, taskident b) {
-  uid_t av = prop->fetch.fetch_uid(ti, a);
-  uid_t bv = prop->fetch.fetch_uid(ti, b);
+  gid_t av = prop->fetch.fetch_gid(ti, a);
+  gid_t bv = prop->fetch.fetch_gid(ti, b);
   const char *ga = lookup_group_by_id(av), *gb;
   ga = xstrdup(ga ? ga : "");
   int rc;
@@ -707,32 +890,11 @@ static int compare_string(const struct propinfo *prop, struct taskinfo *ti,
   return strcmp(av, bv);
 }
 
-static int compare_hier(const struct propinfo *prop, struct taskinfo *ti,
+static int compare_hier(const struct propinfo attribute((unused)) *prop,
+                        struct taskinfo *ti,
                         taskident a, taskident b) {
-  pid_t bp;
-  taskident bptask;
-  int adepth, bdepth;
-  /* Deal with equal tasks first */
-  if(a.pid == b.pid)
-    return 0;
-  /* Put the depths in order */
-  adepth = task_get_depth(ti, a);
-  bdepth = task_get_depth(ti, b);
-  if(adepth > bdepth)
-    return -compare_hier(prop, ti, b, a);
-  assert(adepth <= bdepth);
-  /* Now adepth <= bdepth. */
-  /* If A is B's parent, A < B */
-  bp = task_get_ppid(ti, b);
-  if(a.pid == bp)
-    return -1;
-  /* If A and B share a parent, order them by PID */
-  if(task_get_ppid(ti, a) == bp)
-    return a.pid < b.pid ? -1 : 1;
-  /* Otherwise work back up the tree a bit */
-  bptask.pid = bp;
-  bptask.tid = -1;
-  return compare_hier(prop, ti, a, bptask);
+  size_t ar = task_get_tree_rank(ti, a), br = task_get_tree_rank(ti, b);
+  return ar < br ? -1 : ar > br;
 }
 
 static int compare_sigset(const struct propinfo *prop, struct taskinfo *ti,
@@ -757,400 +919,490 @@ static int compare_sigset(const struct propinfo *prop, struct taskinfo *ti,
 
 static const struct propinfo properties[] = {
   {
-    "%cpu", NULL, "=pcpu", 0, NULL, NULL, {}
+    "%cpu", NULL, "=pcpu", 0, NULL, NULL, {}, 0
   },
   {
     "_hier", NULL, NULL,
-    0,
-    NULL, compare_hier, { }
+    PROP_GLOBAL,
+    NULL, compare_hier, { },
+    TASK_SRC_STAT
   },
   {
     "addr", "ADDR", "Instruction pointer address (hex)",
     PROP_NUMERIC,
-    property_address, compare_uintmax, { .fetch_uintmax = task_get_insn_pointer }
+    property_address, compare_uintmax, { .fetch_uintmax = task_get_insn_pointer },
+    TASK_SRC_STAT
   },
   {
     "args", "COMMAND", "Command with arguments (but path removed)",
     PROP_TEXT,
-    property_command_brief, compare_string, { .fetch_string = task_get_cmdline }
+    property_command_brief, compare_string, { .fetch_string = task_get_cmdline },
+    TASK_SRC_CMDLINE|TASK_SRC_STAT
   },
   {
     "argsfull", "COMMAND", "Command with arguments",
     PROP_TEXT,
-    property_command, compare_string, { .fetch_string = task_get_cmdline }
+    property_command, compare_string, { .fetch_string = task_get_cmdline },
+    TASK_SRC_CMDLINE|TASK_SRC_STAT
   },
   {
-    "cmd", NULL, "=args", 0, NULL, NULL, {}
+    "cmd", NULL, "=args", 0, NULL, NULL, {}, 0
   },
   {
     "comm", "COMMAND", "Command",
     PROP_TEXT,
-    property_command, compare_string, { .fetch_string = task_get_comm }
+    property_command, compare_string, { .fetch_string = task_get_comm },
+    TASK_SRC_STAT
   },
   {
-    "command", NULL, "=args", 0, NULL, NULL, {}
+    "command", NULL, "=args", 0, NULL, NULL, {}, 0
   },
   {
-    "cputime", NULL, "=time", 0, NULL, NULL, {}
+    "cputime", NULL, "=time", 0, NULL, NULL, {}, 0
   },
   {
-    "egid", NULL, "=gid", 0, NULL, NULL, {}
+    "egid", NULL, "=gid", 0, NULL, NULL, {}, 0
   },
   {
-    "egroup", NULL, "=group", 0, NULL, NULL, {}
+    "egroup", NULL, "=group", 0, NULL, NULL, {}, 0
   },
   {
     "etime", "ELAPSED", "Elapsed time (argument: format string)",
     PROP_NUMERIC,
-    property_etime, compare_intmax, { .fetch_intmax = task_get_elapsed_time }
+    property_etime, compare_intmax, { .fetch_intmax = task_get_elapsed_time },
+    TASK_SRC_STAT
   },
   {
-    "euid", NULL, "=uid", 0, NULL, NULL, {}
+    "euid", NULL, "=uid", 0, NULL, NULL, {}, 0
   },
   {
-    "euser", NULL, "=user", 0, NULL, NULL, {}
+    "euser", NULL, "=user", 0, NULL, NULL, {}, 0
   },
   {
-    "f", NULL, "=flags", 0, NULL, NULL, {}
+    "f", NULL, "=flags", 0, NULL, NULL, {}, 0
   },
   {
-    "flag", NULL, "=flags", 0, NULL, NULL, {}
+    "flag", NULL, "=flags", 0, NULL, NULL, {}, 0
   },
   {
     "flags", "F", "Flags (octal; argument o/d/x/X)",
     PROP_NUMERIC,
-    property_uoctal, compare_uintmax, { .fetch_uintmax = task_get_flags }
+    property_uoctal, compare_uintmax, { .fetch_uintmax = task_get_flags },
+    TASK_SRC_STAT
   },
   {
     "fsgid", "FSGID", "Filesystem group ID (decimal)",
     PROP_NUMERIC,
-    property_gid, compare_gid, { .fetch_gid = task_get_fsgid }
+    property_gid, compare_gid, { .fetch_gid = task_get_fsgid },
+    TASK_SRC_STATUS_IDS
   },
   {
     "fsgroup", "FSGROUP", "Filesystem group ID (name)",
     PROP_TEXT,
-    property_group, compare_group, { .fetch_gid = task_get_fsgid }
+    property_group, compare_group, { .fetch_gid = task_get_fsgid },
+    TASK_SRC_STATUS_IDS
   },
   {
     "fsuid", "FSUID", "Filesysem user ID (decimal)",
     PROP_NUMERIC,
-    property_uid, compare_uid, { .fetch_uid = task_get_fsuid }
+    property_uid, compare_uid, { .fetch_uid = task_get_fsuid },
+    TASK_SRC_STATUS_IDS
   },
   {
     "fsuser", "FSUSER", "Filesystem user ID (name)",
     PROP_NUMERIC,
-    property_user, compare_user, { .fetch_uid = task_get_fsuid }
+    property_user, compare_user, { .fetch_uid = task_get_fsuid },
+    TASK_SRC_STATUS_IDS
   },
   {
     "gid", "GID","Effective group ID (decimal)",
     PROP_NUMERIC,
-    property_gid, compare_gid, { .fetch_gid = task_get_egid }
+    property_gid, compare_gid, { .fetch_gid = task_get_egid },
+    TASK_SRC_STATUS_IDS
   },
   {
     "group", "GROUP", "Effective group ID (name)",
     PROP_TEXT,
-    property_group, compare_group, { .fetch_gid = task_get_egid }
+    property_group, compare_group, { .fetch_gid = task_get_egid },
+    TASK_SRC_STATUS_IDS
   },
   {
     "io", "IO", "Recent read+write rate (argument: K/M/G/T/P/p)",
     PROP_NUMERIC,
-    property_iorate, compare_double, { .fetch_double = task_get_rw_bytes }
+    property_iorate, compare_double, { .fetch_double = task_get_rw_bytes },
+    TASK_SRC_IO
   },
   {
     "localtime", "LTIME", "Timestamp (argument: strftime format string)",
     PROP_TEXT,
     property_stime, compare_intmax, { .fetch_intmax = shim_get_time },
+    0
   },
   {
     "locked", "LCK", "Locked memory (argument: K/M/G/T/P/p)",
     PROP_NUMERIC,
-    property_mem, compare_uintmax, { .fetch_uintmax = task_get_locked }
+    property_mem, compare_uintmax, { .fetch_uintmax = task_get_locked },
+    TASK_SRC_STATUS_VM
   },    
   {
-    "lwp", NULL, "=tid", 0, NULL, NULL, {}
-  },
-  {
-    "nlwp", NULL, "=threads", 0, NULL, NULL, {}
+    "lwp", NULL, "=tid", 0, NULL, NULL, {}, 0
   },
   {
     "majflt", "+FLT", "Major fault rate (argument: K/M/G/T/P/p)",
     PROP_NUMERIC,
-    property_iorate, compare_double, { .fetch_double = task_get_majflt }
+    property_iorate, compare_double, { .fetch_double = task_get_majflt },
+    TASK_SRC_STAT
   },
   {
     "mem", "MEM", "Memory usage (argument: K/M/G/T/P/p) ",
     PROP_NUMERIC,
-    property_mem, compare_uintmax, { .fetch_uintmax = task_get_mem }
+    property_mem, compare_uintmax, { .fetch_uintmax = task_get_mem },
+    TASK_SRC_STAT|TASK_SRC_STATUS_VM|TASK_SRC_SMAPS
   },
   {
     "minflt", "-FLT", "Minor fault rate (argument: K/M/G/T/P/p)",
     PROP_NUMERIC,
-    property_iorate, compare_double, { .fetch_double = task_get_minflt }
+    property_iorate, compare_double, { .fetch_double = task_get_minflt },
+    TASK_SRC_STAT
   },
   {
-    "ni", NULL, "=ni", 0, NULL, NULL, {}
+    "ni", NULL, "=nice", 0, NULL, NULL, {}, 0
   },
   {
     "nice", "NI", "Nice value",
     PROP_NUMERIC,
-    property_decimal, compare_intmax, { .fetch_intmax = task_get_nice }
+    property_decimal, compare_intmax, { .fetch_intmax = task_get_nice },
+    TASK_SRC_STAT
+  },
+  {
+    "nlwp", NULL, "=threads", 0, NULL, NULL, {}, 0
   },
   {
     "oom", "OOM", "OOM score",
     PROP_NUMERIC,
-    property_decimal, compare_intmax, { .fetch_intmax = task_get_oom_score }
+    property_decimal, compare_intmax, { .fetch_intmax = task_get_oom_score },
+    TASK_SRC_OOM
   },
   {
     "pcomm", "PCMD", "Parent command name",
-    PROP_TEXT,
+    PROP_TEXT|PROP_GLOBAL,
     property_command, compare_string, { .fetch_string = shim_get_pcomm },
+    TASK_SRC_STAT
   },
   {
     "pcpu", "%CPU", "%age CPU used (argument: precision)",
     PROP_NUMERIC,
-    property_pcpu, compare_double, { .fetch_double = task_get_pcpu }
+    property_pcpu, compare_double, { .fetch_double = task_get_pcpu },
+    TASK_SRC_STAT
   },
   {
-    "pgrp", "PGRP", "Process group ID",
-    PROP_NUMERIC,
-    property_pid, compare_pid, { .fetch_pid = task_get_pgrp }
+    "pgid", NULL, "=pgrp", 0, NULL, NULL, {}, 0
   },
   {
-    "pgrp", NULL, "=pgid", 0, NULL, NULL, {}
+    "pgrp", "PGRP", "Process group ID",
+    PROP_NUMERIC,
+    property_pid, compare_pid, { .fetch_pid = task_get_pgrp },
+    TASK_SRC_STAT
   },
   {
     "pid", "PID", "Process ID",
     PROP_NUMERIC,
-    property_pid, compare_pid, { .fetch_pid = task_get_pid }
+    property_pid, compare_pid, { .fetch_pid = task_get_pid },
+    0
   },
   {
     "pinned", "PIN", "Pinned memory (argument: K/M/G/T/P/p)",
     PROP_NUMERIC,
-    property_mem, compare_uintmax, { .fetch_uintmax = task_get_pinned }
+    property_mem, compare_uintmax, { .fetch_uintmax = task_get_pinned },
+    TASK_SRC_STATUS_VM
   },    
   {
     "pmem", "PMEM", "Proportional memory usage (argument: K/M/G/T/P/p)",
     PROP_NUMERIC,
-    property_mem, compare_uintmax, { .fetch_uintmax = task_get_pmem }
+    property_mem, compare_uintmax, { .fetch_uintmax = task_get_pmem },
+    TASK_SRC_STATUS_VM|TASK_SRC_SMAPS
   },
   {
     "ppid", "PPID", "Parent process ID",
     PROP_NUMERIC,
-    property_pid, compare_pid, { .fetch_pid = task_get_ppid }
+    property_pid, compare_pid, { .fetch_pid = task_get_ppid },
+    TASK_SRC_STAT
   },
   {
     "pri", "PRI", "Priority",
     PROP_NUMERIC,
-    property_decimal, compare_intmax, { .fetch_intmax = task_get_priority }
+    property_decimal, compare_intmax, { .fetch_intmax = task_get_priority },
+    TASK_SRC_STAT
   },
   {
     "pss", "PSS", "Proportional resident set size (argument: K/M/G/T/P/p)",
     PROP_NUMERIC,
-    property_mem, compare_uintmax, { .fetch_uintmax = task_get_pss }
+    property_mem, compare_uintmax, { .fetch_uintmax = task_get_pss },
+    TASK_SRC_SMAPS
   },
   {
     "pte", "PTE", "Page table memory (argument: K/M/G/T/P/p)",
     PROP_NUMERIC,
-    property_mem, compare_uintmax, { .fetch_uintmax = task_get_pte }
+    property_mem, compare_uintmax, { .fetch_uintmax = task_get_pte },
+    TASK_SRC_STATUS_VM
   },    
   {
     "read", "RD", "Recent read rate (argument: K/M/G/T/P/p)",
     PROP_NUMERIC,
-    property_iorate, compare_double, { .fetch_double = task_get_read_bytes }
+    property_iorate, compare_double, { .fetch_double = task_get_read_bytes },
+    TASK_SRC_IO
   },
   {
     "rgid", "RGID", "Real group ID (decimal)",
     PROP_NUMERIC,
-    property_gid, compare_gid, { .fetch_gid = task_get_rgid }
+    property_gid, compare_gid, { .fetch_gid = task_get_rgid },
+    TASK_SRC_STATUS_IDS
   },
   {
     "rgroup", "RGROUP", "Real group ID (name)",
     PROP_TEXT,
-    property_group, compare_group, { .fetch_gid = task_get_rgid }
+    property_group, compare_group, { .fetch_gid = task_get_rgid },
+    TASK_SRC_STATUS_IDS
   },
   {
     "rss", "RSS", "Resident set size (argument: K/M/G/T/P/p)",
     PROP_NUMERIC,
-    property_mem, compare_uintmax, { .fetch_uintmax = task_get_rss }
+    property_mem, compare_uintmax, { .fetch_uintmax = task_get_rss },
+    TASK_SRC_STAT
   },
   {
-    "rsspk", "RSSPK", "Peak resident set size (argument: K/M/G/T/P/p)",
-    PROP_NUMERIC,
-    property_mem, compare_uintmax, { .fetch_uintmax = task_get_peak_rss }
+    "rssize", NULL, "=rss", 0, NULL, NULL, {}, 0
   },
   {
-    "rssize", NULL, "=rss", 0, NULL, NULL, {},
+    "rsspk", "RSSPK", "Peak resident set size (argument: K/M/G/T/P/p)",
+    PROP_NUMERIC,
+    property_mem, compare_uintmax, { .fetch_uintmax = task_get_peak_rss },
+    TASK_SRC_STATUS_VM
   },
   {
-    "rsz", NULL, "=rss", 0, NULL, NULL, {},
+    "rsz", NULL, "=rss", 0, NULL, NULL, {}, 0
   },
   {
     "rtprio", "RTPRI", "Realtime scheduling priority",
     PROP_NUMERIC,
-    property_udecimal, compare_uintmax, { .fetch_uintmax = task_get_rtprio }
+    property_udecimal, compare_uintmax, { .fetch_uintmax = task_get_rtprio },
+    TASK_SRC_STAT
   },
   {
     "ruid", "RUID", "Real user ID (decimal)",
     PROP_NUMERIC,
-    property_uid, compare_uid, { .fetch_uid = task_get_ruid }
+    property_uid, compare_uid, { .fetch_uid = task_get_ruid },
+    TASK_SRC_STATUS_IDS
   },
   {
     "ruser", "RUSER", "Real user ID (name)",
     PROP_TEXT,
-    property_user, compare_user, { .fetch_uid = task_get_ruid }
+    property_user, compare_user, { .fetch_uid = task_get_ruid },
+    TASK_SRC_STATUS_IDS
   },
   {
     "sched", "SCHED", "Scheduling policy",
     PROP_NUMERIC,
-    property_sched, compare_int, { .fetch_int = task_get_sched_policy }
+    property_sched, compare_int, { .fetch_int = task_get_sched_policy },
+    TASK_SRC_STAT
   },
   {
-    "sess", NULL, "=sid", 0, NULL, NULL, {},
+    "sess", NULL, "=sid", 0, NULL, NULL, {}, 0
   },
   {
-    "session", NULL, "=sid", 0, NULL, NULL, {},
+    "session", NULL, "=sid", 0, NULL, NULL, {}, 0
   },
   {
     "sgid", "SGID", "Saved group ID (decimal)",
     PROP_NUMERIC,
-    property_gid, compare_gid, { .fetch_gid = task_get_sgid }
+    property_gid, compare_gid, { .fetch_gid = task_get_sgid },
+    TASK_SRC_STATUS_IDS
   },
   {
     "sgroup", "SGROUP", "Saved group ID (name)",
     PROP_TEXT,
-    property_group, compare_group, { .fetch_gid = task_get_sgid }
+    property_group, compare_group, { .fetch_gid = task_get_sgid },
+    TASK_SRC_STATUS_IDS
   },
   {
     "sid", "SID", "Session ID",
     PROP_NUMERIC,
-    property_pid, compare_pid, { .fetch_pid = task_get_session }
+    property_pid, compare_pid, { .fetch_pid = task_get_session },
+    TASK_SRC_STAT
   },
   {
     "sigblocked", "BLOCKED", "Blocked signals",
     PROP_TEXT,
     property_sigset, compare_sigset, { .fetch_sigset = task_get_sig_blocked },
+    TASK_SRC_STATUS_SIGNALS
   },
   {
     "sigcaught", "CAUGHT", "Caught signals",
     PROP_TEXT,
     property_sigset, compare_sigset, { .fetch_sigset = task_get_sig_caught },
+    TASK_SRC_STATUS_SIGNALS
   },
   {
     "sigignored", "IGNORED", "Ignored signals",
     PROP_TEXT,
     property_sigset, compare_sigset, { .fetch_sigset = task_get_sig_ignored },
+    TASK_SRC_STATUS_SIGNALS
   },
   {
     "sigpending", "PENDING", "Pending signals",
     PROP_TEXT,
     property_sigset, compare_sigset, { .fetch_sigset = task_get_sig_pending },
+    TASK_SRC_STATUS_SIGNALS
   },
   {
     "stack", "STK", "Stack size (argument: K/M/G/T/P/p)",
     PROP_NUMERIC,
-    property_mem, compare_uintmax, { .fetch_uintmax = task_get_stack }
+    property_mem, compare_uintmax, { .fetch_uintmax = task_get_stack },
+    TASK_SRC_STATUS_VM
   },    
   {
     "state", "S", "Process state",
     PROP_TEXT,
-    property_char, compare_int, { .fetch_int = task_get_state }
+    property_char, compare_int, { .fetch_int = task_get_state },
+    TASK_SRC_STAT
   },
   {
     "stime", "STIME", "Start time (argument: strftime format string)",
     PROP_TEXT,
-    property_stime, compare_intmax, { .fetch_intmax = task_get_start_time }
+    property_stime, compare_intmax, { .fetch_intmax = task_get_start_time },
+    TASK_SRC_STAT
   },
   {
     "suid", "SUID", "Saved user ID (decimal)",
     PROP_NUMERIC,
-    property_uid, compare_uid, { .fetch_uid = task_get_suid }
+    property_uid, compare_uid, { .fetch_uid = task_get_suid },
+    TASK_SRC_STATUS_IDS
   },
   {
     "supgid", "SUPGID", "Supplementary group IDs (decimal)",
     PROP_TEXT,
-    property_gids, compare_gids, { .fetch_gids = task_get_supgids }
+    property_gids, compare_gids, { .fetch_gids = task_get_supgids },
+    TASK_SRC_STATUS_GROUPS
   },
   {
     "supgrp", "SUPGRP", "Supplementary group IDs (names)",
     PROP_TEXT,
-    property_groups, compare_gids, { .fetch_gids = task_get_supgids }
+    property_groups, compare_gids, { .fetch_gids = task_get_supgids },
+    TASK_SRC_STATUS_GROUPS
   },
   {
     "suser", "SUSER", "Saved user ID (name)",
     PROP_TEXT,
-    property_user, compare_user, { .fetch_uid = task_get_suid }
+    property_user, compare_user, { .fetch_uid = task_get_suid },
+    TASK_SRC_STATUS_IDS
   },
   {
     "swap", "SWAP", "Swap usage (argument: K/M/G/T/P/p)",
     PROP_NUMERIC,
-    property_mem, compare_uintmax, { .fetch_uintmax = task_get_swap }
+    property_mem, compare_uintmax, { .fetch_uintmax = task_get_swap },
+    TASK_SRC_STATUS_VM|TASK_SRC_SMAPS
   },
   {
-    "thcount", NULL, "=threads", 0, NULL, NULL, {}
+    "thcount", NULL, "=threads", 0, NULL, NULL, {}, 0
   },
   {
     "threads", "T", "Number of threads",
     PROP_NUMERIC,
-    property_num_threads, compare_pid, { .fetch_int = task_get_num_threads }
+    property_num_threads, compare_pid, { .fetch_int = task_get_num_threads },
+    TASK_SRC_STAT
   },
   {
     "tid", "TID", "Thread ID",
     PROP_NUMERIC,
-    property_pid, compare_pid, { .fetch_pid = task_get_tid }
+    property_pid, compare_pid, { .fetch_pid = task_get_tid },
+    0
   },
   {
     "time", "TIME", "Scheduled time (argument: format string)",
     PROP_TEXT,
-    property_time, compare_intmax, { .fetch_intmax = task_get_scheduled_time }
+    property_time, compare_intmax, { .fetch_intmax = task_get_scheduled_time },
+    TASK_SRC_STAT
   },
   {
-    "tname", NULL, "=tty", 0, NULL, NULL, {}
+    "tname", NULL, "=tty", 0, NULL, NULL, {}, 0
   },
   {
     "tpgid", "TPGID", "Foreground progress group on controlling terminal",
     PROP_NUMERIC,
-    property_pid, compare_pid, { .fetch_pid = task_get_tpgid }
+    property_pid, compare_pid, { .fetch_pid = task_get_tpgid },
+    TASK_SRC_STAT
+  },
+  {
+    "treecpu", "T%CPU", "%age CPU used by tree (argument: precision)",
+    PROP_NUMERIC|PROP_GLOBAL,
+    property_pcpu, compare_double, { .fetch_double = task_get_tree_pcpu },
+    TASK_SRC_STAT
+  },
+  {
+    "treeio", "TIO", "Recent read+write rate of tree (argument: K/M/G/T/P/p)",
+    PROP_NUMERIC|PROP_GLOBAL,
+    property_iorate, compare_double, { .fetch_double = task_get_tree_rw_bytes },
+    TASK_SRC_IO
   },
   {
-    "tt", NULL, "=tty", 0, NULL, NULL, {}
+    "treepss", "TPSS", "Proportional resident set size of tree (argument: K/M/G/T/P/p)",
+    PROP_NUMERIC|PROP_GLOBAL,
+    property_mem, compare_uintmax, { .fetch_uintmax = task_get_tree_pss },
+    TASK_SRC_SMAPS
+  },
+  {
+    "treerss", "TRSS", "Resident set size of tree (argument: K/M/G/T/P/p)",
+    PROP_NUMERIC|PROP_GLOBAL,
+    property_mem, compare_uintmax, { .fetch_uintmax = task_get_tree_rss },
+    TASK_SRC_STAT
+  },
+  {
+    "tt", NULL, "=tty", 0, NULL, NULL, {}, 0
   },
   {
     "tty", "TT", "Terminal",
     PROP_TEXT,
-    property_tty, compare_int, { .fetch_int = task_get_tty }
+    property_tty, compare_int, { .fetch_int = task_get_tty },
+    TASK_SRC_STAT
   },
   {
     "uid", "UID", "Effective user ID (decimal)",
     PROP_NUMERIC,
-    property_uid, compare_uid, { .fetch_uid = task_get_euid }
+    property_uid, compare_uid, { .fetch_uid = task_get_euid },
+    TASK_SRC_STATUS_IDS
   },
   {
     "user", "USER", "Effective user ID (name)",
     PROP_TEXT,
-    property_user, compare_user, { .fetch_uid = task_get_euid }
+    property_user, compare_user, { .fetch_uid = task_get_euid },
+    TASK_SRC_STATUS_IDS
   },
   {
-    "vsize", NULL, "=vsz", 0, NULL, NULL, {}
+    "vsize", NULL, "=vsz", 0, NULL, NULL, {}, 0
   },
   {
     "vsz", "VSZ", "Virtual memory used (argument: K/M/G/T/P/p)",
     PROP_NUMERIC,
-    property_mem, compare_uintmax, { .fetch_uintmax = task_get_vsize }
+    property_mem, compare_uintmax, { .fetch_uintmax = task_get_vsize },
+    TASK_SRC_STAT
   },
   {
     "vszpk", "VSZPK", "Peak virtual memory used (argument: K/M/G/T/P/p)",
     PROP_NUMERIC,
-    property_mem, compare_uintmax, { .fetch_uintmax = task_get_peak_vsize }
+    property_mem, compare_uintmax, { .fetch_uintmax = task_get_peak_vsize },
+    TASK_SRC_STATUS_VM
   },
   {
     "wchan", "WCHAN", "Wait channel (hex)",
     PROP_NUMERIC,
-    property_address, compare_uintmax, { .fetch_uintmax = task_get_wchan }
+    property_address, compare_uintmax, { .fetch_uintmax = task_get_wchan },
+    TASK_SRC_STAT
   },
   {
     "write", "WR", "Recent write rate (argument: K/M/G/T/P/p)",
     PROP_NUMERIC,
-    property_iorate, compare_double, { .fetch_double = task_get_write_bytes }
+    property_iorate, compare_double, { .fetch_double = task_get_write_bytes },
+    TASK_SRC_IO
   },
 };
 #define NPROPERTIES (sizeof properties / sizeof *properties)
@@ -1224,6 +1476,62 @@ void format_clear(void) {
   columns = NULL;
 }
 
+/* Return the number of characters format_integer() produces for IM
+ * in decimal */
+static size_t decimal_width(intmax_t im) {
+  uintmax_t u = im < 0 ? -(uintmax_t)im : (uintmax_t)im;
+  size_t w = im < 0 ? 2 : 1;
+  while(u >= 10) {
+    u /= 10;
+    ++w;
+  }
+  return w;
+}
+
+/* Return the number of characters format_integer() produces for U
+ * as an unsigned decimal */
+static size_t udecimal_width(uintmax_t u) {
+  size_t w = 1;
+  while(u >= 10) {
+    u /= 10;
+    ++w;
+  }
+  return w;
+}
+
+/* Return the width of a column's value for a task.  Where the value
+ * is a plain integer or character its width is worked out directly;
+ * anything else is rendered into B to find out how big it is. */
+static size_t format_value_width(const struct column *col,
+                                 struct buffer *b,
+                                 struct taskinfo *ti, taskident task) {
+  const struct propinfo *prop = col->prop;
+  pid_t pid;
+  int count;
+
+  if(prop->format == property_decimal)
+    return decimal_width(prop->fetch.fetch_intmax(ti, task));
+  if(prop->format == property_udecimal)
+    return udecimal_width(prop->fetch.fetch_intmax(ti, task));
+  if(prop->format == property_pid) {
+    pid = prop->fetch.fetch_pid(ti, task);
+    return pid > 0 ? decimal_width(pid) : 1;
+  }
+  if(prop->format == property_num_threads) {
+    count = prop->fetch.fetch_int(ti, task);
+    return count >= 0 ? decimal_width(count) : 1;
+  }
+  if(prop->format == property_uid)
+    return decimal_width(prop->fetch.fetch_uid(ti, task));
+  if(prop->format == property_gid)
+    return decimal_width(prop->fetch.fetch_gid(ti, task));
+  if(prop->format == property_char)
+    return 1;
+  b->pos = 0;
+  prop->format(col, b, col->reqwidth, ti, task, 0);
+  return b->pos;
+}
+
 void format_columns(struct taskinfo *ti, const taskident *tasks, size_t ntasks) {
   size_t n = 0, c;
 
@@ -1234,19 +1542,12 @@ void format_columns(struct taskinfo *ti, const taskident *tasks, size_t ntasks)
   for(c = 0; c < ncolumns; ++c) {
     size_t wmin, w = strlen(*columns[c].heading
                             ? columns[c].heading
-                            : columns[c].prop->heading);
+                            : columns[c].prop->heading), vw;
     // We make columns wide enough for everything that may be
     // put in them.
-    for(n = 0; n < ntasks; ++n) {
-      // Render the value to a false buffer to find out how big it is
-      struct buffer b[1];
-      buffer_init(b);
-      columns[c].prop->format(&columns[c], b, columns[c].reqwidth,
-                              ti, tasks[n], 0);
-      free(b->base);
-      if(b->pos > w)
-        w = b->pos;
-    }
+    for(n = 0; n < ntasks; ++n)
+      if((vw = format_value_width(&columns[c], cell, ti, tasks[n])) > w)
+        w = vw;
     /* We make the columns as wide as they have needed to be at any
      * point in the recent past, to avoid columns wobbling too
      * much. */
@@ -1272,21 +1573,41 @@ void format_heading(struct taskinfo *ti, struct buffer *b) {
     format_task(ti, tnone, b);
 }
 
+/* Return the length of the initial part of S[0..N) that is printable
+ * ASCII.  Eight bytes are checked at a time: in each byte of the
+ * test, the first term sets the top bit if the byte is below ' ', the
+ * second if it is above '~' and the third if it is not ASCII at
+ * all. */
+static size_t printable_span(const char *s, size_t n) {
+  const uint64_t ones = 0x0101010101010101;
+  uint64_t w;
+  size_t i = 0;
+
+  while(i + sizeof w <= n) {
+    memcpy(&w, s + i, sizeof w);
+    if(((w - ones * ' ') | (w + ones * (0x80 - 0x7F)) | w) & (ones * 0x80))
+      break;
+    i += sizeof w;
+  }
+  while(i < n && (unsigned char)s[i] >= ' ' && (unsigned char)s[i] < 0x7F)
+    ++i;
+  return i;
+}
+
 void format_task(struct taskinfo *ti, taskident task, struct buffer *b) {
-  struct buffer bb[1];
-  size_t i, c;
-  ssize_t left;
-  int ch;
+  size_t c, n, span;
+  const char *s, *q;
   b->pos = 0;
-  buffer_init(bb);
   for(c = 0; c < ncolumns; ++c) {
     /* Render the value or heading */
-    bb->pos = 0;
-    /* Emit it in the chosen syntax */
+    cell->pos = 0;
     if(task.pid == -1)
-      buffer_append(bb, columns[c].heading);
+      buffer_append(cell, columns[c].heading);
     else
-      columns[c].prop->format(&columns[c], bb, columns[c].width, ti, task, 0);
+      columns[c].prop->format(&columns[c], cell, columns[c].width, ti, task, 0);
+    s = cell->base;
+    n = cell->pos;
+    /* Emit it in the chosen syntax */
     switch(syntax) {
     case syntax_normal:
       /* Replace unprintable characters with ?
@@ -1294,52 +1615,64 @@ void format_task(struct taskinfo *ti, taskident task, struct buffer *b) {
        * This is a bit stricter than procps, which accepts bytes from
        * non-ASCII characters.
        */
-      for(i = 0; i < bb->pos; ++i) {
-        ch = (unsigned char)bb->base[i];
-        if(ch < ' ' || ch >= 0x7F)
-          buffer_putc(b, '?');
-        else
-          buffer_putc(b, ch);
+      while(n) {
+        span = printable_span(s, n);
+        buffer_append_n(b, s, span);
+        if(span == n)
+          break;
+        buffer_putc(b, '?');
+        s += span + 1;
+        n -= span + 1;
       }
       /* For non-final columns, pad to the column width and one more for
        * the column separator */
-      if(c + 1 < ncolumns) {
+      if(c + 1 < ncolumns && 1 + columns[c].width > cell->pos)
         /* NB assumes that number of bytes = displayed width */
-        left = 1 + columns[c].width - bb->pos;
-        while(left-- > 0)
-          buffer_putc(b, ' ');
-      }
+        buffer_pad(b, ' ', 1 + columns[c].width - cell->pos);
       break;
     case syntax_csv:
       if(c > 0)
         buffer_putc(b, ',');
       if(columns[c].prop->flags & PROP_TEXT) {
         buffer_putc(b, '"');
-        for(i = 0; i < bb->pos; ++i) {
-          ch = bb->base[i];
-          if(ch == '"')
-            buffer_putc(b, '"');
-          buffer_putc(b, ch);
+        /* Double up quotes */
+        while(n && (q = memchr(s, '"', n))) {
+          buffer_append_n(b, s, q + 1 - s);
+          buffer_putc(b, '"');
+          n -= q + 1 - s;
+          s = q + 1;
         }
+        if(n)
+          buffer_append_n(b, s, n);
         buffer_putc(b, '"');
-      } else {
-        buffer_append_n(b, bb->base, bb->pos);
+      } else if(n) {
+        buffer_append_n(b, s, n);
       }
       break;
     }
   }
   buffer_terminate(b);
-  free(bb->base);
 }
 
 void format_value(struct taskinfo *ti, taskident task,
                   const char *property,
                   struct buffer *b,
                   unsigned flags) {
-  struct column c;              /* stunt column */
+  format_property_value(format_find_property(property), ti, task, b, flags);
+}
+
+const struct propinfo *format_find_property(const char *property) {
   const struct propinfo *prop = find_property(property, 0);
   if(!prop)
     fatal(0, "unknown task property '%s'", property);
+  return prop;
+}
+
+void format_property_value(const struct propinfo *prop,
+                           struct taskinfo *ti, taskident task,
+                           struct buffer *b,
+                           unsigned flags) {
+  struct column c;              /* stunt column */
   c.prop = prop;
   c.reqwidth = SIZE_MAX;
   c.width = SIZE_MAX;
@@ -1350,6 +1683,88 @@ void format_value(struct taskinfo *ti, taskident task,
   buffer_terminate(b);
 }
 
+int format_property_is_integer(const struct propinfo *prop) {
+  return (prop->format == property_decimal
+          || prop->format == property_udecimal
+          || prop->format == property_pid
+          || prop->format == property_num_threads
+          || prop->format == property_uid
+          || prop->format == property_gid
+          || prop->format == property_mem
+          || prop->format == property_iorate);
+}
+
+/* This must agree with what the format functions produce for
+ * FORMAT_RAW. */
+int format_property_integer(const struct propinfo *prop,
+                            struct taskinfo *ti, taskident task,
+                            uintmax_t *value) {
+  intmax_t im;
+  if(prop->format == property_decimal) {
+    if((im = prop->fetch.fetch_intmax(ti, task)) < 0)
+      return 0;
+    *value = im;
+  } else if(prop->format == property_udecimal)
+    *value = prop->fetch.fetch_intmax(ti, task);
+  else if(prop->format == property_pid) {
+    if((im = prop->fetch.fetch_pid(ti, task)) <= 0)
+      return 0;
+    *value = im;
+  } else if(prop->format == property_num_threads) {
+    if((im = prop->fetch.fetch_int(ti, task)) < 0)
+      return 0;
+    *value = im;
+  } else if(prop->format == property_uid)
+    *value = prop->fetch.fetch_uid(ti, task);
+  else if(prop->format == property_gid)
+    *value = prop->fetch.fetch_gid(ti, task);
+  else if(prop->format == property_mem)
+    *value = prop->fetch.fetch_uintmax(ti, task);
+  else if(prop->format == property_iorate)
+    *value = prop->fetch.fetch_double(ti, task);
+  else
+    fatal(0, "property '%s' has no integer value", prop->name);
+  return 1;
+}
+
+unsigned format_property_sources(const char *property) {
+  const struct propinfo *prop = find_property(property, 0);
+  return prop ? prop->sources : 0;
+}
+
+unsigned format_sources(void) {
+  return format_column_sources() | format_order_sources();
+}
+
+unsigned format_column_sources(void) {
+  unsigned sources = 0;
+  size_t n;
+  for(n = 0; n < ncolumns; ++n)
+    sources |= columns[n].prop->sources;
+  return sources;
+}
+
+unsigned format_order_sources(void) {
+  unsigned sources = 0;
+  size_t n;
+  for(n = 0; n < norders; ++n)
+    sources |= orders[n].prop->sources;
+  return sources;
+}
+
+int format_global(void) {
+  size_t n;
+  if(format_hierarchy)
+    return 1;
+  for(n = 0; n < ncolumns; ++n)
+    if(columns[n].prop->flags & PROP_GLOBAL)
+      return 1;
+  for(n = 0; n < norders; ++n)
+    if(orders[n].prop->flags & PROP_GLOBAL)
+      return 1;
+  return 0;
+}
+
 int format_ordering(const char *ordering, unsigned flags) {
   char *name;
   const struct propinfo *prop;
@@ -1421,6 +1836,209 @@ int format_compare(struct taskinfo *ti, taskident a, taskident b) {
   return 0;
 }
 
+/* Task information for sort_compare() */
+static struct taskinfo *sort_taskinfo;
+
+static int sort_compare(const void *av, const void *bv) {
+  return format_compare(sort_taskinfo,
+                        *(const taskident *)av, *(const taskident *)bv);
+}
+
+/* format_select() sorts everything when selecting more than this
+ * fraction of the tasks */
+#define FORMAT_SELECT_RATIO 8
+
+/* Map a signed value to an unsigned key with the same order */
+#define SIGNED_KEY(v) ((uint64_t)(int64_t)(v) ^ ((uint64_t)1 << 63))
+
+/* Map a double to an unsigned key with the same order.  -0 and +0
+ * compare equal, and NaN compares equal to everything; both become
+ * 0. */
+static uint64_t double_key(double v) {
+  uint64_t bits;
+  if(v == 0 || isnan(v))
+    v = 0;
+  memcpy(&bits, &v, sizeof bits);
+  return (bits & ((uint64_t)1 << 63)) ? ~bits : bits | ((uint64_t)1 << 63);
+}
+
+/* Return nonzero if an ordering can be expressed as a sort key */
+static int sort_key_supported(const struct propinfo *prop) {
+  return (prop->compare == compare_int
+          || prop->compare == compare_intmax
+          || prop->compare == compare_uintmax
+          || prop->compare == compare_pid
+          || prop->compare == compare_uid
+          || prop->compare == compare_gid
+          || prop->compare == compare_double
+          || prop->compare == compare_hier
+          || prop->compare == compare_string
+          || prop->compare == compare_user
+          || prop->compare == compare_group);
+}
+
+struct sort_string {
+  const char *s;
+  size_t index;
+};
+
+static int sort_string_compare(const void *av, const void *bv) {
+  const struct sort_string *a = av, *b = bv;
+  return strcmp(a->s, b->s);
+}
+
+/* Fill in the key for ORDER for each task.  Key I goes in
+ * KEYS[I * NWORDS].  Strings are replaced by their rank among the
+ * distinct values, so a single comparison of all of them replaces
+ * one per pair of tasks compared. */
+static void sort_keys(struct taskinfo *ti, const taskident *tasks,
+                      size_t ntasks, const struct order *order,
+                      uint64_t *keys, size_t nwords) {
+  const struct propinfo *prop = order->prop;
+  struct sort_string *strings;
+  const char *s;
+  uint64_t key = 0, rank;
+  size_t n;
+
+  if(prop->compare == compare_string
+     || prop->compare == compare_user
+     || prop->compare == compare_group) {
+    strings = xrecalloc(NULL, ntasks, sizeof *strings);
+    for(n = 0; n < ntasks; ++n) {
+      if(prop->compare == compare_string)
+        s = prop->fetch.fetch_string(ti, tasks[n]);
+      else if(prop->compare == compare_user)
+        s = lookup_user_by_id(prop->fetch.fetch_uid(ti, tasks[n]));
+      else
+        s = lookup_group_by_id(prop->fetch.fetch_gid(ti, tasks[n]));
+      if(!s)
+        s = "";
+      /* Name lookups may reuse their buffer */
+      strings[n].s = prop->compare == compare_string ? s : xstrdup(s);
+      strings[n].index = n;
+    }
+    qsort(strings, ntasks, sizeof *strings, sort_string_compare);
+    for(rank = 0, n = 0; n < ntasks; ++n) {
+      if(n && strcmp(strings[n].s, strings[n - 1].s))
+        ++rank;
+      keys[strings[n].index * nwords] = rank;
+    }
+    if(prop->compare != compare_string)
+      for(n = 0; n < ntasks; ++n)
+        free((char *)strings[n].s);
+    free(strings);
+  } else {
+    for(n = 0; n < ntasks; ++n) {
+      if(prop->compare == compare_int)
+        key = SIGNED_KEY(prop->fetch.fetch_int(ti, tasks[n]));
+      else if(prop->compare == compare_intmax)
+        key = SIGNED_KEY(prop->fetch.fetch_intmax(ti, tasks[n]));
+      else if(prop->compare == compare_uintmax)
+        key = prop->fetch.fetch_uintmax(ti, tasks[n]);
+      else if(prop->compare == compare_pid)
+        key = SIGNED_KEY(prop->fetch.fetch_pid(ti, tasks[n]));
+      else if(prop->compare == compare_uid)
+        key = prop->fetch.fetch_uid(ti, tasks[n]);
+      else if(prop->compare == compare_gid)
+        key = prop->fetch.fetch_gid(ti, tasks[n]);
+      else if(prop->compare == compare_double)
+        key = double_key(prop->fetch.fetch_double(ti, tasks[n]));
+      else if(prop->compare == compare_hier)
+        key = task_get_tree_rank(ti, tasks[n]);
+      keys[n * nwords] = key;
+    }
+  }
+  if(order->sign < 0)
+    for(n = 0; n < ntasks; ++n)
+      keys[n * nwords] = ~keys[n * nwords];
+}
+
+/* Each task's ordering is extracted once into a row of fixed-width
+ * keys, one per ordering followed by the PID and thread ID
+ * tie-breakers.  Comparing rows as unsigned integers then gives the
+ * same order as format_compare(), and they can be radix sorted.
+ * Returns NULL if some ordering cannot be expressed this way. */
+static uint64_t *sort_build_keys(struct taskinfo *ti, const taskident *tasks,
+                                 size_t ntasks, size_t nwords) {
+  uint64_t *keys;
+  size_t n;
+
+  for(n = 0; n < norders; ++n)
+    if(!sort_key_supported(orders[n].prop))
+      return NULL;
+  keys = xrecalloc(NULL, ntasks, nwords * sizeof *keys);
+  for(n = 0; n < norders; ++n)
+    sort_keys(ti, tasks, ntasks, &orders[n], keys + n, nwords);
+  for(n = 0; n < ntasks; ++n) {
+    keys[n * nwords + norders] = SIGNED_KEY(tasks[n].pid);
+    keys[n * nwords + norders + 1] = (unsigned long)tasks[n].tid;
+  }
+  return keys;
+}
+
+/* Move the NSELECTED tasks listed in ORDER to the front of TASKS.
+ * The rest keep their relative order. */
+static void sort_permute(taskident *tasks, size_t ntasks,
+                         const size_t *order, size_t nselected) {
+  taskident *sorted;
+  char *selected;
+  size_t n, m;
+
+  sorted = xrecalloc(NULL, ntasks, sizeof *sorted);
+  for(n = 0; n < nselected; ++n)
+    sorted[n] = tasks[order[n]];
+  if(nselected < ntasks) {
+    selected = xmalloc(ntasks);
+    memset(selected, 0, ntasks);
+    for(n = 0; n < nselected; ++n)
+      selected[order[n]] = 1;
+    for(n = 0, m = nselected; n < ntasks; ++n)
+      if(!selected[n])
+        sorted[m++] = tasks[n];
+    free(selected);
+  }
+  memcpy(tasks, sorted, ntasks * sizeof *tasks);
+  free(sorted);
+}
+
+void format_sort(struct taskinfo *ti, taskident *tasks, size_t ntasks) {
+  const size_t nwords = norders + 2;
+  uint64_t *keys;
+  size_t *order;
+
+  if(!(keys = sort_build_keys(ti, tasks, ntasks, nwords))) {
+    sort_taskinfo = ti;
+    qsort(tasks, ntasks, sizeof *tasks, sort_compare);
+    return;
+  }
+  order = xrecalloc(NULL, ntasks, sizeof *order);
+  keysort(order, keys, ntasks, nwords, task_workers);
+  sort_permute(tasks, ntasks, order, ntasks);
+  free(order);
+  free(keys);
+}
+
+size_t format_select(struct taskinfo *ti, taskident *tasks, size_t ntasks,
+                     size_t k) {
+  const size_t nwords = norders + 2;
+  uint64_t *keys;
+  size_t *order;
+
+  /* Selecting a large fraction of the tasks is no cheaper than
+   * sorting them all */
+  if(k >= ntasks / FORMAT_SELECT_RATIO
+     || !(keys = sort_build_keys(ti, tasks, ntasks, nwords))) {
+    format_sort(ti, tasks, ntasks);
+    return ntasks;
+  }
+  order = xrecalloc(NULL, k, sizeof *order);
+  k = keyselect(order, keys, ntasks, nwords, k);
+  sort_permute(tasks, ntasks, order, k);
+  free(order);
+  free(keys);
+  return k;
+}
+
 char **format_help(void) {
   size_t n;
   char *ptr, **result, **next;
@@ -1489,8 +2107,17 @@ int format_rate(struct taskinfo *ti, unsigned procflags) {
   taskident *tasks = NULL;
   size_t ntasks;
   struct buffer b[1];
+  unsigned sources = 0;
   
   buffer_init(b);
+  for(n = 0; n < ncolumns; ++n)
+    if(columns[n].prop->format == property_pcpu
+       || columns[n].prop->format == property_iorate)
+      sources |= columns[n].prop->sources;
+  if(sources) {
+    tasks = task_get_all(ti, &ntasks, procflags);
+    task_prefetch(ti, tasks, ntasks, sources);
+  }
   for(n = 0; n < ncolumns; ++n) {
     if(columns[n].prop->format == property_pcpu
        || columns[n].prop->format == property_iorate) {
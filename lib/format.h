@@ -39,6 +39,7 @@
 #include <sys/types.h>
 
 struct buffer;
+struct propinfo;
 
 /** @brief Format string is in argument syntax */
 #define FORMAT_ARGUMENT 0x0000
@@ -161,6 +162,50 @@ void format_value(struct taskinfo *ti, taskident task,
                   struct buffer *b,
                   unsigned flags);
 
+/** @brief Look up a property
+ * @param property Property name
+ * @return Property
+ *
+ * Calls fatal() if @p property does not exist.  Aliases are resolved.
+ */
+const struct propinfo *format_find_property(const char *property);
+
+/** @brief Format a single property given its handle
+ * @param prop Property, from format_find_property()
+ * @param ti Pointer to task information
+ * @param task Process or thread ID
+ * @param b Where to store output
+ * @param flags Flags
+ *
+ * Equivalent to format_value() but without the name lookup.
+ */
+void format_property_value(const struct propinfo *prop,
+                           struct taskinfo *ti, taskident task,
+                           struct buffer *b,
+                           unsigned flags);
+
+/** @brief Test whether a property has an integer value
+ * @param prop Property, from format_find_property()
+ * @return Nonzero if format_property_integer() may be used
+ */
+int format_property_is_integer(const struct propinfo *prop);
+
+/** @brief Retrieve a property as an integer
+ * @param prop Property, from format_find_property()
+ * @param ti Pointer to task information
+ * @param task Process or thread ID
+ * @param value Where to store value
+ * @return 1 if a value was stored, 0 otherwise
+ *
+ * The value stored is the one that format_property_value() would
+ * render in decimal with @ref FORMAT_RAW.  0 is returned when it would
+ * render something that is not a decimal integer, i.e. "-" or a
+ * negative number.
+ */
+int format_property_integer(const struct propinfo *prop,
+                            struct taskinfo *ti, taskident task,
+                            uintmax_t *value);
+
 /** @brief Set the task ordering
  * @param ordering Ordering specification
  * @param flags Flags
@@ -184,6 +229,69 @@ int format_ordering(const char *ordering, unsigned flags);
  */
 int format_compare(struct taskinfo *ti, taskident a, taskident b);
 
+/** @brief Sort tasks into the current ordering
+ * @param ti Pointer to task information
+ * @param tasks Tasks to sort
+ * @param ntasks Number of tasks
+ *
+ * The result is the same as sorting with format_compare().  Where
+ * every ordering allows it, the sort keys of each task are extracted
+ * once and the tasks radix sorted by them (see keysort()), instead of
+ * fetching properties for every comparison.
+ */
+void format_sort(struct taskinfo *ti, taskident *tasks, size_t ntasks);
+
+/** @brief Put the first few tasks into the current ordering
+ * @param ti Pointer to task information
+ * @param tasks Tasks to sort
+ * @param ntasks Number of tasks
+ * @param k Number of tasks wanted
+ * @return Number of tasks at the start of @p tasks that are in order
+ *
+ * On return the first @p k tasks are the ones format_sort() would
+ * have put first, in the same order.  The rest are in no particular
+ * order.  The return value is at least @p k, or @p ntasks if that is
+ * smaller.  It may be more than @p k if it was cheaper to sort
+ * everything.
+ */
+size_t format_select(struct taskinfo *ti, taskident *tasks, size_t ntasks,
+                     size_t k);
+
+/** @brief Identify the sources needed by the current format and ordering
+ * @return Bitmap of @ref TASK_SRC_STAT etc
+ *
+ * The return value is suitable for passing to task_prefetch().
+ */
+unsigned format_sources(void);
+
+/** @brief Identify the sources needed by the current format
+ * @return Bitmap of @ref TASK_SRC_STAT etc
+ *
+ * This covers the columns only, not the ordering.
+ */
+unsigned format_column_sources(void);
+
+/** @brief Identify the sources needed by the current ordering
+ * @return Bitmap of @ref TASK_SRC_STAT etc
+ *
+ * This covers the ordering only, not the columns.
+ */
+unsigned format_order_sources(void);
+
+/** @brief Identify the sources needed by a property
+ * @param property Property name
+ * @return Bitmap of @ref TASK_SRC_STAT etc, or 0 if not known
+ */
+unsigned format_property_sources(const char *property);
+
+/** @brief Test whether formatting depends on other tasks
+ * @return Nonzero if the current format or ordering needs tasks
+ * other than the ones displayed
+ *
+ * For instance, the parent command name or the process hierarchy.
+ */
+int format_global(void);
+
 /** @brief Return formatting help
  * @return NULL-terminated list of strings
  *
@@ -280,6 +388,22 @@ int format_rate(struct taskinfo *ti, unsigned procflags);
  */
 void format_integer(intmax_t im, struct buffer *b, int base);
 
+/** @brief Space needed by format_digits() */
+#define FORMAT_DIGITS_MAX 24
+
+/** @brief Convert an unsigned integer to digits
+ * @param end Pointer just past the space for the digits
+ * @param n Value to convert
+ * @param base Base: 8, 10 or 16
+ * @param upper Nonzero for upper case hex digits
+ * @return Pointer to the first digit
+ *
+ * The digits are written backwards from @p end, with no terminator.
+ * There is room for a sign before them if the space is
+ * @ref FORMAT_DIGITS_MAX bytes long.
+ */
+char *format_digits(char *end, uintmax_t n, int base, int upper);
+
 /** @brief Format an address value
  * @param im Value to format
  * @param b String buffer for output
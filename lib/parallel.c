@@ -0,0 +1,131 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "parallel.h"
+#include "utils.h"
+#include <pthread.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* Below this many items, automatic selection sticks to one worker */
+#define PARALLEL_THRESHOLD 2048
+
+/* Upper limit on automatically chosen worker count */
+#define PARALLEL_MAX 16
+
+/* Upper limit on explicitly requested worker count */
+#define PARALLEL_LIMIT 256
+
+/* Maximum number of items a worker claims at once */
+#define PARALLEL_CHUNK 32
+
+struct parallel_job {
+  parallel_function *fn;
+  void *u;
+  size_t nitems;
+  size_t chunk;                 /* items to claim at once */
+  size_t next;                  /* next unclaimed item */
+};
+
+struct parallel_worker {
+  struct parallel_job *job;
+  unsigned worker;
+};
+
+unsigned parallel_workers(unsigned requested, size_t nitems) {
+  long ncpus;
+  if(requested)
+    return requested;
+  if(nitems < PARALLEL_THRESHOLD)
+    return 1;
+  ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if(ncpus < 1)
+    return 1;
+  return min(ncpus, PARALLEL_MAX);
+}
+
+static void parallel_work(struct parallel_job *job, unsigned worker) {
+  size_t i, limit;
+  for(;;) {
+    i = __atomic_fetch_add(&job->next, job->chunk, __ATOMIC_RELAXED);
+    if(i >= job->nitems)
+      break;
+    limit = min(i + job->chunk, job->nitems);
+    while(i < limit)
+      job->fn(job->u, i++, worker);
+  }
+}
+
+static void *parallel_thread(void *u) {
+  struct parallel_worker *w = u;
+  parallel_work(w->job, w->worker);
+  return NULL;
+}
+
+void parallel_run(size_t nitems, unsigned workers,
+                  parallel_function *fn, void *u) {
+  struct parallel_job job;
+  struct parallel_worker *w;
+  pthread_t *threads;
+  unsigned n;
+  size_t i;
+  int rc;
+
+  if(workers > nitems)
+    workers = nitems;
+  if(workers <= 1) {
+    for(i = 0; i < nitems; ++i)
+      fn(u, i, 0);
+    return;
+  }
+  job.fn = fn;
+  job.u = u;
+  job.nitems = nitems;
+  /* Small chunks for small jobs, so that every worker gets a share */
+  job.chunk = max(min(nitems / (4 * workers), PARALLEL_CHUNK), 1);
+  job.next = 0;
+  threads = xrecalloc(NULL, workers, sizeof *threads);
+  w = xrecalloc(NULL, workers, sizeof *w);
+  for(n = 1; n < workers; ++n) {
+    w[n].job = &job;
+    w[n].worker = n;
+    if((rc = pthread_create(&threads[n], NULL, parallel_thread, &w[n])))
+      fatal(rc, "pthread_create");
+  }
+  parallel_work(&job, 0);
+  for(n = 1; n < workers; ++n)
+    if((rc = pthread_join(threads[n], NULL)))
+      fatal(rc, "pthread_join");
+  free(w);
+  free(threads);
+}
+
+unsigned parse_workers(const char *s) {
+  unsigned long workers;
+  char *e;
+  errno = 0;
+  workers = strtoul(s, &e, 10);
+  if(errno)
+    fatal(errno, "invalid worker count '%s'", s);
+  if(e == s || *e || *s == '-' || workers > PARALLEL_LIMIT)
+    fatal(0, "invalid worker count '%s'", s);
+  return workers;
+}
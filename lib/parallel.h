@@ -0,0 +1,72 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+/** @file parallel.h
+ * @brief Simple worker pool
+ */
+
+#include <stddef.h>
+
+/** @brief Signature of a work function
+ * @param u Context pointer passed to parallel_run()
+ * @param i Index of work item
+ * @param worker Index of the calling worker
+ *
+ * @p worker is between 0 and one less than the number of workers.
+ * Worker 0 is always the thread that called parallel_run().
+ */
+typedef void parallel_function(void *u, size_t i, unsigned worker);
+
+/** @brief Choose a number of workers
+ * @param requested Requested number of workers, or 0 to choose automatically
+ * @param nitems Number of work items
+ * @return Number of workers to use
+ *
+ * When @p requested is 0, a single worker is used for small jobs
+ * and one per online CPU (up to a small limit) for large ones.
+ */
+unsigned parallel_workers(unsigned requested, size_t nitems);
+
+/** @brief Call a function for a range of work items
+ * @param nitems Number of work items
+ * @param workers Number of workers
+ * @param fn Function to call for each item
+ * @param u Context pointer for @p fn
+ *
+ * @p fn is called exactly once for each value from 0 to @p nitems -
+ * 1, in no particular order.  If @p workers is more than 1 then
+ * additional threads are created and the calls are shared between
+ * them; this function returns when all of them are complete.
+ */
+void parallel_run(size_t nitems, unsigned workers,
+                  parallel_function *fn, void *u);
+
+/** @brief Parse a worker count
+ * @param s Worker count
+ * @return Number of workers
+ *
+ * The return value is suitable for passing to parallel_workers().
+ * 0 means to choose automatically.
+ */
+unsigned parse_workers(const char *s);
+
+#endif /* PARALLEL_H */
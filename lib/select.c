@@ -20,7 +20,10 @@
 #include <config.h>
 #include "selectors.h"
 #include "utils.h"
+#include "format.h"
+#include "compare.h"
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 struct selector {
@@ -90,10 +93,13 @@ static const char *get_operator(const char *ptr,
   return 0;
 }
 
-void select_match(const char *expr) {
+select_function *select_match_compile(const char *expr,
+                                      union arg **argsp, size_t *nargsp) {
   const char *ptr;
   union arg *args;
-  int rc, operator;
+  struct matcher *m;
+  select_function *sfn;
+  int rc;
   char buffer[128];
 
   for(ptr = expr; 
@@ -103,32 +109,62 @@ void select_match(const char *expr) {
     ;
   if(!*ptr)
     fatal(0, "invalid match expression '%s'", expr);
-  args = xmalloc(3 * sizeof *args);
+  args = xmalloc(2 * sizeof *args);
+  m = xmalloc(sizeof *m);
+  memset(m, 0, sizeof *m);
+  buffer_init(&m->buffer);
   args[0].string = xstrndup(expr, ptr - expr);
-  ptr = get_operator(ptr, &operator);
+  args[1].matcher = m;
+  m->prop = format_find_property(args[0].string);
+  ptr = get_operator(ptr, &m->operator);
   if(!ptr)
     fatal(0, "%s: unrecognized match operator\n", expr);
   if(*ptr == ':')
      ++ptr;
-  switch(operator) {
+  switch(m->operator) {
   case '~':
-    rc = regcomp(&args[1].regex, ptr, REG_ICASE|REG_NOSUB);
+    rc = regcomp(&m->regex, ptr, REG_ICASE|REG_NOSUB);
     if(rc) {
-      regerror(rc, &args[1].regex, buffer, sizeof buffer);
+      regerror(rc, &m->regex, buffer, sizeof buffer);
       fatal(0, "regexec: %s", buffer);
     }
-    select_add(select_regex_match, args, 2);
+    sfn = select_regex_match;
     break;
   case IDENTICAL:
-    args[1].string = xstrdup(ptr);
-    select_add(select_string_match, args, 2);
+    m->string = xstrdup(ptr);
+    sfn = select_string_match;
     break;
   default:
-    args[1].operator = operator;
-    args[2].string = xstrdup(ptr);
-    select_add(select_compare, args, 3);
+    m->string = xstrdup(ptr);
+    m->integer = (format_property_is_integer(m->prop)
+                  && qlparse(m->string, &m->value));
+    sfn = select_compare;
     break;
   }
+  *argsp = args;
+  *nargsp = 2;
+  return sfn;
+}
+
+void select_match(const char *expr) {
+  select_function *sfn;
+  union arg *args;
+  size_t nargs;
+  sfn = select_match_compile(expr, &args, &nargs);
+  select_add(sfn, args, nargs);
+}
+
+void select_match_free(select_function attribute((unused)) *sfn,
+                       union arg *args,
+                       size_t attribute((unused)) nargs) {
+  struct matcher *m = args[1].matcher;
+  if(m->operator == '~')
+    regfree(&m->regex);
+  free(m->string);
+  free(m->buffer.base);
+  free(m);
+  free(args[0].string);
+  free(args);
 }
 
 int select_test(struct taskinfo *ti, taskident task) {
@@ -136,10 +172,46 @@ int select_test(struct taskinfo *ti, taskident task) {
   assert(nselectors > 0);
   for(n = 0; n < nselectors; ++n)
     if(selectors[n].sfn(ti, task, selectors[n].args, selectors[n].nargs))
-      return 1;
+      return select_filter_test(ti, task);
   return 0;
 }
 
+unsigned select_sources(void) {
+  unsigned sources = 0;
+  size_t n;
+  for(n = 0; n < nselectors; ++n)
+    sources |= select_function_sources(selectors[n].sfn,
+                                        selectors[n].args,
+                                        selectors[n].nargs);
+  return sources | select_filter_sources();
+}
+
+static int compare_pid(const void *av, const void *bv) {
+  pid_t a = *(const pid_t *)av, b = *(const pid_t *)bv;
+  return a < b ? -1 : a > b;
+}
+
+int select_candidates(struct select_candidates *c) {
+  size_t n, m;
+  if(!nselectors)
+    return 0;
+  for(n = 0; n < nselectors; ++n)
+    if(select_function_candidates(c, selectors[n].sfn,
+                                  selectors[n].args,
+                                  selectors[n].nargs) < 0) {
+      free(c->pids);
+      c->pids = NULL;
+      c->npids = c->nslots = 0;
+      return 0;
+    }
+  qsort(c->pids, c->npids, sizeof *c->pids, compare_pid);
+  for(n = m = 0; n < c->npids; ++n)
+    if(!m || c->pids[n] != c->pids[m - 1])
+      c->pids[m++] = c->pids[n];
+  c->npids = m;
+  return 1;
+}
+
 void select_default(select_function *sfn, union arg *args, size_t nargs) {
   if(!nselectors)
     select_add(sfn, args, nargs);
@@ -29,6 +29,10 @@
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
 
 uid_t forceuid = -1;
 
@@ -174,26 +178,30 @@ int select_nonidle(struct taskinfo *ti, taskident task,
 
 int select_string_match(struct taskinfo *ti, taskident task, union arg *args,
                         size_t nargs) {
-  struct buffer b[1];
-  int rc;
+  struct matcher *m = args[1].matcher;
   assert(nargs == 2);
-  buffer_init(b);
-  format_value(ti, task, args[0].string, b, 0);
-  rc = !strcmp(b->base, args[1].string);
-  free(b->base);
-  return rc;
+  format_property_value(m->prop, ti, task, &m->buffer, 0);
+  return !strcmp(m->buffer.base, m->string);
 }
 
 int select_compare(struct taskinfo *ti, taskident task, union arg *args,
                    size_t nargs) {
-  struct buffer b[1];
+  struct matcher *m = args[1].matcher;
+  uintmax_t value;
   int c;
-  assert(nargs == 3);
-  buffer_init(b);
-  format_value(ti, task, args[0].string, b, FORMAT_RAW);
-  c = qlcompare(b->base, args[2].string);
-  free(b->base);
-  switch(args[1].operator) {
+  assert(nargs == 2);
+  if(m->integer) {
+    /* Anything that isn't a plain integer starts with '-', which
+     * qlcompare() puts before any digit */
+    if(format_property_integer(m->prop, ti, task, &value))
+      c = value < m->value ? -1 : value > m->value;
+    else
+      c = -1;
+  } else {
+    format_property_value(m->prop, ti, task, &m->buffer, FORMAT_RAW);
+    c = qlcompare(m->buffer.base, m->string);
+  }
+  switch(m->operator) {
   case '<': return c < 0;
   case '=': return c == 0;
   case '>': return c > 0;
@@ -201,27 +209,317 @@ int select_compare(struct taskinfo *ti, taskident task, union arg *args,
   case GE: return c >= 0;
   case NE: return c != 0;
   default:
-    fatal(0, "unrecognized comparison operator %#x", args[1].operator);
+    fatal(0, "unrecognized comparison operator %#x", m->operator);
   }
 }
 
 int select_regex_match(struct taskinfo *ti, taskident task, union arg *args,
                        size_t nargs) {
+  struct matcher *m = args[1].matcher;
   char buffer[1024];
-  struct buffer b[1];
   int rc;
   assert(nargs == 2);
-  buffer_init(b);
-  format_value(ti, task, args[0].string, b, 0);
-  rc = regexec(&args[1].regex, b->base, 0, 0, 0);
-  free(b->base);
+  format_property_value(m->prop, ti, task, &m->buffer, 0);
+  rc = regexec(&m->regex, m->buffer.base, 0, 0, 0);
   switch(rc) {
   case 0:
     return 1;
   case REG_NOMATCH:
     return 0;
   default:
-    regerror(rc, &args[1].regex, buffer, sizeof buffer);
+    regerror(rc, &m->regex, buffer, sizeof buffer);
     fatal(0, "regexec: %s", buffer);
   }
 }
+
+// ----------------------------------------------------------------------------
+
+/* Some selectors can produce a list of candidate processes without
+ * looking at every process in /proc.  The candidates are a superset
+ * of the processes selected; select_test() still has the final
+ * say. */
+
+static void append_pid(struct select_candidates *c, pid_t pid) {
+  if(c->npids >= c->nslots) {
+    if((ssize_t)(c->nslots = c->nslots ? 2 * c->nslots : 64) <= 0)
+      fatal(0, "too many tasks");
+    c->pids = xrecalloc(c->pids, c->nslots, sizeof *c->pids);
+  }
+  c->pids[c->npids++] = pid;
+}
+
+/* Read PATH (relative to DIRFD) into a 0-terminated buffer.  Returns
+ * NULL on error. */
+static char *read_proc_file(int dirfd, const char *path) {
+  char *buffer = NULL;
+  size_t len = 0, size = 0;
+  ssize_t n;
+  int fd, save_errno;
+
+  if((fd = openat(dirfd, path, O_RDONLY|O_CLOEXEC)) < 0)
+    return NULL;
+  for(;;) {
+    if(size - len < 2)
+      buffer = xrealloc(buffer, size = size ? 2 * size : 1024);
+    if((n = read(fd, buffer + len, size - len - 1)) < 0) {
+      if(errno == EINTR)
+        continue;
+      save_errno = errno;
+      free(buffer);
+      close(fd);
+      errno = save_errno;
+      return NULL;
+    }
+    if(!n)
+      break;
+    len += n;
+  }
+  close(fd);
+  buffer[len] = 0;
+  return buffer;
+}
+
+/* Return nonzero if PID is a process, rather than a thread or
+ * nothing at all */
+static int is_process(int procfd, pid_t pid) {
+  char path[64], *status, *tgid;
+  int rc = 0;
+
+  snprintf(path, sizeof path, "%ld/status", (long)pid);
+  if((status = read_proc_file(procfd, path))) {
+    if((tgid = strstr(status, "\nTgid:")))
+      rc = strtol(tgid + 6, NULL, 10) == pid;
+    free(status);
+  }
+  return rc;
+}
+
+/* Call FN for each numeric entry in directory PATH (relative to
+ * DIRFD), stopping if it returns nonzero.  Returns -1 if the
+ * directory could not be read, otherwise the last return from FN. */
+static int each_id(int dirfd, const char *path,
+                   int (*fn)(struct select_candidates *c, pid_t id, void *u),
+                   struct select_candidates *c, void *u) {
+  struct dirent *de;
+  DIR *dp;
+  int fd, rc = 0;
+
+  if((fd = openat(dirfd, path, O_RDONLY|O_DIRECTORY|O_CLOEXEC)) < 0)
+    return -1;
+  if(!(dp = fdopendir(fd))) {
+    close(fd);
+    return -1;
+  }
+  while(!rc && (de = readdir(dp)))
+    if(de->d_name[0] >= '0' && de->d_name[0] <= '9')
+      rc = fn(c, strtol(de->d_name, NULL, 10), u);
+  closedir(dp);
+  return rc;
+}
+
+/* Append the children of thread TID of process *PIDP.  Returns 1 if
+ * the kernel does not provide children files (before Linux 3.5, or
+ * without CONFIG_PROC_CHILDREN). */
+static int thread_children(struct select_candidates *c, pid_t tid, void *u) {
+  pid_t pid = *(pid_t *)u;
+  char path[64], *children, *ptr, *end;
+  long child;
+
+  snprintf(path, sizeof path, "%ld/task/%ld/children",
+           (long)pid, (long)tid);
+  if(!(children = read_proc_file(c->procfd, path))) {
+    if(errno != ENOENT)
+      return 0;
+    /* Either the thread has gone, or there are no children files */
+    snprintf(path, sizeof path, "%ld/task/%ld", (long)pid, (long)tid);
+    return faccessat(c->procfd, path, F_OK, 0) == 0;
+  }
+  ptr = children;
+  for(;;) {
+    child = strtol(ptr, &end, 10);
+    if(end == ptr)
+      break;
+    append_pid(c, child);
+    ptr = end;
+  }
+  free(children);
+  return 0;
+}
+
+/* Append the children of PID.  Returns -1 if that's not possible,
+ * including when PID can't be read at all: it might be 0, or a
+ * process that has gone but whose children haven't been reparented
+ * yet, or one we're not allowed to look at. */
+static int process_children(struct select_candidates *c, pid_t pid) {
+  char path[64];
+
+  snprintf(path, sizeof path, "%ld/task", (long)pid);
+  return each_id(c->procfd, path, thread_children, c, &pid) ? -1 : 0;
+}
+
+static int candidates_pid(struct select_candidates *c,
+                          union arg *args, size_t nargs) {
+  size_t n;
+  for(n = 0; n < nargs; ++n)
+    if(is_process(c->procfd, args[n].pid))
+      append_pid(c, args[n].pid);
+  return 0;
+}
+
+static int candidates_ppid(struct select_candidates *c,
+                           union arg *args, size_t nargs) {
+  size_t n;
+  for(n = 0; n < nargs; ++n)
+    if(process_children(c, args[n].pid) < 0)
+      return -1;
+  return 0;
+}
+
+static int candidates_apid(struct select_candidates *c,
+                           union arg *args, size_t nargs) {
+  size_t n;
+
+  /* select_apid() can match arguments that aren't processes (e.g. 0),
+   * so they can't just be dropped */
+  for(n = 0; n < nargs; ++n)
+    if(!is_process(c->procfd, args[n].pid))
+      return -1;
+  for(n = 0; n < nargs; ++n)
+    append_pid(c, args[n].pid);
+  /* Breadth-first walk of the descendants */
+  for(n = c->npids - nargs; n < c->npids; ++n)
+    if(process_children(c, c->pids[n]) < 0)
+      return -1;
+  return 0;
+}
+
+struct select_owner {
+  const union arg *args;
+  size_t nargs;
+  int gid;                      /* nonzero to match group, else user */
+  long overflow;                /* ID that unmapped IDs appear as */
+};
+
+/* The owner of /proc/PID is the effective UID and GID of the
+ * process.  Kernels before 4.11 made it root instead if the process
+ * was not dumpable; that appears as 0, or as the overflow ID when
+ * root is not mapped in our user namespace.  Entries owned by either
+ * say nothing about the process, so they are kept.
+ *
+ * Later kernels give the other files under /proc/PID of a
+ * non-dumpable process to the root of its user namespace, which might
+ * appear as any ID at all (e.g. 100000 for a container), but the
+ * directory itself keeps the effective IDs; only it is looked at
+ * here.  Threads are not considered at all; see candidates_owner(). */
+static int owner_match(struct select_candidates *c, pid_t pid, void *u) {
+  const struct select_owner *o = u;
+  char path[64];
+  struct stat sb;
+  size_t n;
+  long id;
+
+  snprintf(path, sizeof path, "%ld", (long)pid);
+  if(fstatat(c->procfd, path, &sb, 0) < 0)
+    return 0;
+  id = o->gid ? (long)sb.st_gid : (long)sb.st_uid;
+  if(id == 0 || id == o->overflow) {
+    append_pid(c, pid);
+    return 0;
+  }
+  for(n = 0; n < o->nargs; ++n)
+    if(o->gid ? sb.st_gid == o->args[n].gid : sb.st_uid == o->args[n].uid) {
+      append_pid(c, pid);
+      break;
+    }
+  return 0;
+}
+
+/* Return the ID that IDs not mapped in our user namespace appear as */
+static long overflow_id(struct select_candidates *c, int gid) {
+  char *contents;
+  long id = 65534;              /* the kernel's default */
+
+  if((contents = read_proc_file(c->procfd, (gid
+                                            ? "sys/kernel/overflowgid"
+                                            : "sys/kernel/overflowuid")))) {
+    id = strtol(contents, NULL, 10);
+    free(contents);
+  }
+  return id;
+}
+
+static int candidates_owner(struct select_candidates *c,
+                            union arg *args, size_t nargs, int gid) {
+  struct select_owner o[1];
+  /* A thread's effective IDs may differ from its process's, and only
+   * the process's are visible here */
+  if(c->threads)
+    return -1;
+  o->args = args;
+  o->nargs = nargs;
+  o->gid = gid;
+  o->overflow = overflow_id(c, gid);
+  return each_id(c->procfd, ".", owner_match, c, o) < 0 ? -1 : 0;
+}
+
+static int candidates_euid(struct select_candidates *c,
+                           union arg *args, size_t nargs) {
+  return candidates_owner(c, args, nargs, 0);
+}
+
+static int candidates_egid(struct select_candidates *c,
+                           union arg *args, size_t nargs) {
+  return candidates_owner(c, args, nargs, 1);
+}
+
+// ----------------------------------------------------------------------------
+
+static const struct {
+  select_function *sfn;
+  unsigned sources;
+  int (*candidates)(struct select_candidates *c,
+                    union arg *args, size_t nargs);
+} selector_info[] = {
+  { select_has_terminal, TASK_SRC_STAT, NULL },
+  { select_all, 0, NULL },
+  { select_not_session_leader, TASK_SRC_STAT, NULL },
+  { select_pid, 0, candidates_pid },
+  { select_ppid, TASK_SRC_STAT, candidates_ppid },
+  { select_apid, TASK_SRC_STAT, candidates_apid },
+  { select_terminal, TASK_SRC_STAT, NULL },
+  { select_leader, TASK_SRC_STAT, NULL },
+  { select_rgid, TASK_SRC_STATUS_IDS, NULL },
+  { select_egid, TASK_SRC_STATUS_IDS, candidates_egid },
+  { select_euid, TASK_SRC_STATUS_IDS, candidates_euid },
+  { select_ruid, TASK_SRC_STATUS_IDS, NULL },
+  { select_uid_tty, TASK_SRC_STAT|TASK_SRC_STATUS_IDS, NULL },
+  { select_nonidle, TASK_SRC_STAT, NULL },
+};
+#define NSELECTOR_INFO (sizeof selector_info / sizeof *selector_info)
+
+unsigned select_function_sources(select_function *sfn,
+                                 union arg *args,
+                                 size_t attribute((unused)) nargs) {
+  size_t n;
+  if(sfn == select_string_match
+     || sfn == select_compare
+     || sfn == select_regex_match)
+    return format_property_sources(args[0].string);
+  for(n = 0; n < NSELECTOR_INFO; ++n)
+    if(selector_info[n].sfn == sfn)
+      return selector_info[n].sources;
+  /* Unknown selectors load whatever they need on demand */
+  return 0;
+}
+
+int select_function_candidates(struct select_candidates *c,
+                               select_function *sfn,
+                               union arg *args, size_t nargs) {
+  size_t n;
+  for(n = 0; n < NSELECTOR_INFO; ++n)
+    if(selector_info[n].sfn == sfn)
+      return selector_info[n].candidates
+        ? selector_info[n].candidates(c, args, nargs)
+        : -1;
+  return -1;
+}
@@ -25,11 +25,14 @@
  */
 
 #include "tasks.h"
+#include "buffer.h"
 
 #include <sys/types.h>
 #include <regex.h>
+#include <stdint.h>
 
 struct taskinfo;
+struct propinfo;
 
 /** @brief Argument type for selectors
  *
@@ -53,6 +56,37 @@ union arg {
   regex_t regex;                /**< @brief Compiled regexp */
 
   int operator;                 /**< @brief Comparison operator */
+
+  struct matcher *matcher;      /**< @brief Compiled match expression
+                                 * Set by select_match(). */
+};
+
+/** @brief Compiled match expression
+ *
+ * The property is looked up, and the value parsed, just once, when
+ * the expression is compiled by select_match().
+ */
+struct matcher {
+  /** @brief Property to match */
+  const struct propinfo *prop;
+
+  /** @brief Comparison operator */
+  int operator;
+
+  /** @brief Nonzero to compare integers rather than strings */
+  int integer;
+
+  /** @brief Integer value to compare against */
+  uintmax_t value;
+
+  /** @brief String value to compare against */
+  char *string;
+
+  /** @brief Compiled regexp */
+  regex_t regex;
+
+  /** @brief Space for formatted property values */
+  struct buffer buffer;
 };
 
 /** @brief Parse a user name or UID
@@ -105,6 +139,15 @@ union arg *split_arg(char *arg,
 
 // ----------------------------------------------------------------------------
 
+/** @brief Candidate processes found before enumeration */
+struct select_candidates {
+  int procfd;                   /**< @brief FD for /proc */
+  pid_t *pids;                  /**< @brief Candidate process IDs */
+  size_t npids;                 /**< @brief Number of candidates */
+  size_t nslots;                /**< @brief Space in @c pids */
+  int threads;                  /**< @brief Nonzero if threads are wanted */
+};
+
 /** @brief Signature of a selector function
  * @param ti Pointer to task information
  * @param pid Process ID
@@ -137,9 +180,33 @@ void select_match(const char *expr);
  * If at least one reistered selector function returns nonzero then
  * the return value is 0.  If all return zero then the return value is
  * zero.
+ *
+ * A task selected this way must also pass any filter registered with
+ * select_filter().
  */
 int select_test(struct taskinfo *ti, taskident pident);
 
+/** @brief Identify the sources needed by the registered selectors
+ * @return Bitmap of @ref TASK_SRC_STAT etc
+ *
+ * The return value is suitable for passing to task_prefetch().
+ */
+unsigned select_sources(void);
+
+/** @brief Find candidate processes for the registered selectors
+ * @param c Where to store candidates
+ * @return Nonzero if candidates were found, 0 if not possible
+ *
+ * The caller must set @c c->procfd and @c c->threads, and initialize
+ * the rest of @p c to 0.  @c c->threads must be nonzero if the
+ * threads of the candidates will be tested too.  On success, @c
+ * c->pids is a sorted list of distinct process IDs, owned by the
+ * caller, that includes every process that select_test() might
+ * select.  Processes not in the list need not be
+ * enumerated.  On failure @p c is left empty.
+ */
+int select_candidates(struct select_candidates *c);
+
 /** @brief Set the default selector
  * @param sfn Selector function
  * @param args Selector argument
@@ -153,6 +220,66 @@ void select_default(select_function *sfn, union arg *args, size_t nargs);
 /** @brief Clear all selectors */
 void select_clear(void);
 
+/** @brief Compile a match expression
+ * @param expr Match expression
+ * @param argsp Where to store selector arguments
+ * @param nargsp Where to store argument count
+ * @return Selector function
+ *
+ * This is the same as select_match() except that the resulting
+ * selector is returned rather than registered.  The arguments may be
+ * freed with select_match_free().
+ */
+select_function *select_match_compile(const char *expr,
+                                      union arg **argsp, size_t *nargsp);
+
+/** @brief Free a compiled match expression
+ * @param sfn Selector function from select_match_compile()
+ * @param args Selector arguments from select_match_compile()
+ * @param nargs Argument count from select_match_compile()
+ */
+void select_match_free(select_function *sfn, union arg *args, size_t nargs);
+
+/** @brief Register a filter expression
+ * @param expr Filter expression
+ *
+ * A filter expression combines match expressions (see select_match())
+ * with @c and, @c or, @c not and parentheses.  @c not binds most
+ * tightly and @c or least tightly.  Match expressions containing
+ * spaces or parentheses must be quoted.
+ *
+ * Unlike other selectors, filters restrict the selection: a task is
+ * only selected if it passes every registered filter.  Within a
+ * filter, cheaper tests are made first, so that (for instance) @c
+ * smaps is only read for tasks that pass the other tests.
+ *
+ * Calls fatal() if @p expr is not valid.
+ */
+void select_filter(const char *expr);
+
+/** @brief Clear all filters
+ *
+ * select_clear() does not do this.
+ */
+void select_filter_clear(void);
+
+/** @brief Test a task against the registered filters
+ * @param ti Pointer to task information
+ * @param task Process/thread ID
+ * @return Nonzero if @p task passes every filter
+ *
+ * If no filters are registered, every task passes.
+ */
+int select_filter_test(struct taskinfo *ti, taskident task);
+
+/** @brief Identify the sources worth prefetching for the registered filters
+ * @return Bitmap of @ref TASK_SRC_STAT etc
+ *
+ * Expensive sources, such as @ref TASK_SRC_SMAPS, are not included;
+ * they are only read for tasks that need them.
+ */
+unsigned select_filter_sources(void);
+
 // ---------------------------------------------------------------------------
 
 /** @brief Select processes that have a controlling terminal
@@ -324,7 +451,7 @@ int select_nonidle(struct taskinfo *ti, taskident task, union arg *args,
  * @return Nonzero to select @p pid
  *
  * @p nargs must be 2.  The first argument should be a property name
- * and the second a value
+ * and the second a @ref matcher.
  */
 int select_string_match(struct taskinfo *ti, taskident task, union arg *args,
                         size_t nargs);
@@ -337,7 +464,7 @@ int select_string_match(struct taskinfo *ti, taskident task, union arg *args,
  * @return Nonzero to select @p pid
  *
  * @p nargs must be 2.  The first argument should be a property name
- * and the second a compiled regexp.
+ * and the second a @ref matcher.
  */
 int select_regex_match(struct taskinfo *ti, taskident task, union arg *args,
                        size_t nargs);
@@ -349,9 +476,12 @@ int select_regex_match(struct taskinfo *ti, taskident task, union arg *args,
  * @param nargs Argument cout as passed to @ref select_add()
  * @return Nonzero to select @p pid
  *
- * @p nargs must be 3.  The first argument should be a property name;
- * the second a comparison operator; and the third a value to compare
- * against.
+ * @p nargs must be 2.  The first argument should be a property name
+ * and the second a @ref matcher.
+ *
+ * Values are compared with qlcompare() on their raw string form.
+ * Where the property and the value to compare against are both plain
+ * integers, they are compared directly instead, with the same result.
  *
  * The possible comparions operators are:
  * - '<'
@@ -367,6 +497,33 @@ int select_regex_match(struct taskinfo *ti, taskident task, union arg *args,
 int select_compare(struct taskinfo *ti, taskident task, union arg *args,
                    size_t nargs);
 
+/** @brief Identify the sources needed by a selector function
+ * @param sfn Selector function
+ * @param args Selector argument as passed to @ref select_add()
+ * @param nargs Argument cout as passed to @ref select_add()
+ * @return Bitmap of @ref TASK_SRC_STAT etc
+ *
+ * 0 is returned for selector functions not known to this module.
+ */
+unsigned select_function_sources(select_function *sfn,
+                                 union arg *args,
+                                 size_t nargs);
+
+/** @brief Find candidate processes for a selector function
+ * @param c Where to add candidates
+ * @param sfn Selector function
+ * @param args Selector argument as passed to @ref select_add()
+ * @param nargs Argument cout as passed to @ref select_add()
+ * @return 0 on success, -1 if candidates can't be found in advance
+ *
+ * Every process that @p sfn might select is added to @p c, without
+ * reading all of /proc where possible.  The list may contain
+ * duplicates and processes that would not be selected.
+ */
+int select_function_candidates(struct select_candidates *c,
+                               select_function *sfn,
+                               union arg *args, size_t nargs);
+
 /** @brief String identity comparison operator */
 #define IDENTICAL 0x2261
 
@@ -0,0 +1,251 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "sort.h"
+#include "parallel.h"
+#include "utils.h"
+#include <string.h>
+#include <stdlib.h>
+
+/* Below this many records, insertion sort is used */
+#define KEYSORT_SMALL 32
+
+/* Minimum number of records in a run sorted by a single worker */
+#define KEYSORT_RUN 65536
+
+struct keysort {
+  const uint64_t *keys;
+  size_t nwords;
+  size_t *order;
+  size_t *scratch;
+  size_t *bounds;               /* run boundaries */
+  size_t nruns;                 /* number of runs */
+  size_t width;                 /* runs per input to a merge */
+  size_t *from, *to;            /* merge source and destination */
+};
+
+/* Return nonzero if record A sorts before record B */
+static inline int keysort_less(const struct keysort *ks, size_t a, size_t b) {
+  const uint64_t *ka = ks->keys + a * ks->nwords;
+  const uint64_t *kb = ks->keys + b * ks->nwords;
+  size_t w;
+  for(w = 0; w < ks->nwords; ++w)
+    if(ka[w] != kb[w])
+      return ka[w] < kb[w];
+  return 0;
+}
+
+static void keysort_insertion(const struct keysort *ks, size_t *order,
+                              size_t n) {
+  size_t i, j, r;
+  for(i = 1; i < n; ++i) {
+    r = order[i];
+    for(j = i; j > 0 && keysort_less(ks, r, order[j - 1]); --j)
+      order[j] = order[j - 1];
+    order[j] = r;
+  }
+}
+
+/* Sort ORDER[0..N) using SCRATCH as working space.  Digit D is byte
+ * D % 8 of word NWORDS - 1 - D / 8, counting from the least
+ * significant, so the digits are visited in the order LSD radix sort
+ * needs. */
+static void keysort_radix(const struct keysort *ks, size_t *order,
+                          size_t *scratch, size_t n) {
+  const size_t nwords = ks->nwords, ndigits = nwords * 8;
+  size_t d, i, r, b, c, total, word, *counts, *count, *from, *to, *t;
+  const uint64_t *k;
+  unsigned shift;
+
+  if(n < KEYSORT_SMALL) {
+    keysort_insertion(ks, order, n);
+    return;
+  }
+  /* The digit histograms don't depend on the order of the records, so
+   * they can all be gathered in a single pass over the keys */
+  counts = xrecalloc(NULL, ndigits * 256, sizeof *counts);
+  memset(counts, 0, ndigits * 256 * sizeof *counts);
+  for(i = 0; i < n; ++i) {
+    k = ks->keys + order[i] * nwords;
+    count = counts;
+    for(word = nwords; word-- > 0;)
+      for(shift = 0; shift < 64; shift += 8, count += 256)
+        ++count[(k[word] >> shift) & 255];
+  }
+  from = order;
+  to = scratch;
+  for(d = 0; d < ndigits; ++d) {
+    count = counts + d * 256;
+    word = nwords - 1 - d / 8;
+    shift = d % 8 * 8;
+    /* Digits that are the same in every record need no pass */
+    if(count[(ks->keys[from[0] * nwords + word] >> shift) & 255] == n)
+      continue;
+    for(total = 0, b = 0; b < 256; ++b) {
+      c = count[b];
+      count[b] = total;
+      total += c;
+    }
+    for(i = 0; i < n; ++i) {
+      r = from[i];
+      to[count[(ks->keys[r * nwords + word] >> shift) & 255]++] = r;
+    }
+    t = from;
+    from = to;
+    to = t;
+  }
+  if(from != order)
+    memcpy(order, from, n * sizeof *order);
+  free(counts);
+}
+
+static void keysort_run(void *u, size_t i,
+                        unsigned attribute((unused)) worker) {
+  struct keysort *ks = u;
+  size_t first = ks->bounds[i];
+
+  keysort_radix(ks, ks->order + first, ks->scratch + first,
+                ks->bounds[i + 1] - first);
+}
+
+/* Merge runs [I*2*WIDTH, I*2*WIDTH+WIDTH) and the following WIDTH runs
+ * from FROM into TO.  Ties go to the left input, keeping the sort
+ * stable. */
+static void keysort_merge(void *u, size_t i,
+                          unsigned attribute((unused)) worker) {
+  struct keysort *ks = u;
+  size_t first = i * 2 * ks->width;
+  size_t a = ks->bounds[first];
+  size_t alimit = ks->bounds[min(first + ks->width, ks->nruns)];
+  size_t b = alimit;
+  size_t blimit = ks->bounds[min(first + 2 * ks->width, ks->nruns)];
+  size_t o = a;
+
+  while(a < alimit && b < blimit)
+    ks->to[o++] = (keysort_less(ks, ks->from[b], ks->from[a])
+                   ? ks->from[b++] : ks->from[a++]);
+  memcpy(ks->to + o, ks->from + a, (alimit - a) * sizeof *ks->to);
+  o += alimit - a;
+  memcpy(ks->to + o, ks->from + b, (blimit - b) * sizeof *ks->to);
+}
+
+/* Return nonzero if record A comes before record B in keysort()
+ * order.  Ties go to the lower record number, as the radix sort is
+ * stable. */
+static inline int keyselect_before(const struct keysort *ks,
+                                   size_t a, size_t b) {
+  if(keysort_less(ks, a, b))
+    return 1;
+  if(keysort_less(ks, b, a))
+    return 0;
+  return a < b;
+}
+
+/* Restore the heap property below HEAP[I], where HEAP[0..N) is a heap
+ * with the last record in order at the top */
+static void keyselect_sift(const struct keysort *ks, size_t *heap,
+                           size_t n, size_t i) {
+  size_t child, r = heap[i];
+
+  while((child = 2 * i + 1) < n) {
+    if(child + 1 < n && keyselect_before(ks, heap[child], heap[child + 1]))
+      ++child;
+    if(!keyselect_before(ks, r, heap[child]))
+      break;
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = r;
+}
+
+size_t keyselect(size_t *order, const uint64_t *keys, size_t nrecords,
+                 size_t nwords, size_t k) {
+  struct keysort ks;
+  size_t i, n, r;
+
+  if(k > nrecords)
+    k = nrecords;
+  ks.keys = keys;
+  ks.nwords = nwords;
+  /* Keep the K smallest records seen so far in a heap, largest at
+   * the top, so most records need only be compared with the top */
+  for(i = 0; i < k; ++i)
+    order[i] = i;
+  for(i = k / 2; i-- > 0;)
+    keyselect_sift(&ks, order, k, i);
+  for(i = k; i < nrecords; ++i)
+    if(k && keyselect_before(&ks, i, order[0])) {
+      order[0] = i;
+      keyselect_sift(&ks, order, k, 0);
+    }
+  /* Put the survivors in order */
+  for(n = k; n > 1;) {
+    --n;
+    r = order[0];
+    order[0] = order[n];
+    order[n] = r;
+    keyselect_sift(&ks, order, n, 0);
+  }
+  return k;
+}
+
+void keysort(size_t *order, const uint64_t *keys, size_t nrecords,
+             size_t nwords, unsigned workers) {
+  struct keysort ks;
+  unsigned nworkers = 1;
+  size_t i, *t;
+
+  for(i = 0; i < nrecords; ++i)
+    order[i] = i;
+  if(nrecords < 2 || !nwords)
+    return;
+  ks.keys = keys;
+  ks.nwords = nwords;
+  ks.order = order;
+  ks.scratch = xrecalloc(NULL, nrecords, sizeof *ks.scratch);
+  if(nrecords >= 2 * KEYSORT_RUN)
+    nworkers = min(parallel_workers(workers, nrecords),
+                   nrecords / KEYSORT_RUN);
+  if(nworkers <= 1) {
+    keysort_radix(&ks, order, ks.scratch, nrecords);
+    free(ks.scratch);
+    return;
+  }
+  /* Sort one run per worker, then merge pairs of runs until only one
+   * is left */
+  ks.nruns = nworkers;
+  ks.bounds = xrecalloc(NULL, ks.nruns + 1, sizeof *ks.bounds);
+  for(i = 0; i <= ks.nruns; ++i)
+    ks.bounds[i] = nrecords * i / ks.nruns;
+  parallel_run(ks.nruns, nworkers, keysort_run, &ks);
+  ks.from = order;
+  ks.to = ks.scratch;
+  for(ks.width = 1; ks.width < ks.nruns; ks.width *= 2) {
+    parallel_run((ks.nruns + 2 * ks.width - 1) / (2 * ks.width), nworkers,
+                 keysort_merge, &ks);
+    t = ks.from;
+    ks.from = ks.to;
+    ks.to = t;
+  }
+  if(ks.from != order)
+    memcpy(order, ks.from, nrecords * sizeof *order);
+  free(ks.bounds);
+  free(ks.scratch);
+}
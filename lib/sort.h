@@ -0,0 +1,68 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#ifndef SORT_H
+#define SORT_H
+
+/** @file sort.h
+ * @brief Sorting by precomputed keys
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Sort records by fixed-width keys
+ * @param order Where to store the sorted order (@p nrecords entries)
+ * @param keys Keys, @p nwords consecutive words per record
+ * @param nrecords Number of records
+ * @param nwords Number of key words per record
+ * @param workers Requested number of workers, or 0 to choose automatically
+ *
+ * Records are compared word by word, the first word being the most
+ * significant, as unsigned integers.  On return @p order holds record
+ * numbers, smallest key first.  The sort is stable.
+ *
+ * Large inputs are sorted by LSD radix sort over the key bytes,
+ * skipping bytes that are the same in every record.  Very large
+ * inputs are split into runs that are sorted in parallel and then
+ * merged.
+ */
+void keysort(size_t *order, const uint64_t *keys, size_t nrecords,
+             size_t nwords, unsigned workers);
+
+/** @brief Find the smallest records by fixed-width keys
+ * @param order Where to store the selected records (@p k entries)
+ * @param keys Keys, @p nwords consecutive words per record
+ * @param nrecords Number of records
+ * @param nwords Number of key words per record
+ * @param k Number of records to select
+ * @return Number of records selected
+ *
+ * Keys are compared as for keysort().  On return the first entries
+ * of @p order hold the record numbers of the @p k smallest records,
+ * smallest first, in the same order keysort() would give them.  If
+ * there are fewer than @p k records then all are selected.
+ *
+ * A bounded heap is used, so the cost is proportional to @p nrecords
+ * times log @p k, rather than sorting everything.
+ */
+size_t keyselect(size_t *order, const uint64_t *keys, size_t nrecords,
+                 size_t nwords, size_t k);
+
+#endif /* SORT_H */
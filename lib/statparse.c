@@ -0,0 +1,153 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "statparse.h"
+#include <stdint.h>
+#include <string.h>
+
+#define ONES UINT64_C(0x0101010101010101)
+#define HIGHS UINT64_C(0x8080808080808080)
+
+/* Load 8 bytes with the first byte in the least significant position */
+static inline uint64_t load8(const char *ptr) {
+  uint64_t v;
+  memcpy(&v, ptr, sizeof v);
+#if WORDS_BIGENDIAN
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+}
+
+/* Convert up to 8 digits at once.  D holds the digit values (not
+ * characters), first digit in the least significant byte; N is the
+ * number of digits, from 1 to 8. */
+static inline uint64_t convert8(uint64_t d, unsigned n) {
+  /* Shift the digits to the top, so that the bytes below are leading
+   * zeros */
+  d <<= 8 * (8 - n);
+  d = (d * 10 + (d >> 8)) & UINT64_C(0x00FF00FF00FF00FF);
+  d = (d * 100 + (d >> 16)) & UINT64_C(0x0000FFFF0000FFFF);
+  d = (d * 10000 + (d >> 32)) & UINT64_C(0x00000000FFFFFFFF);
+  return d;
+}
+
+static const uint64_t powers[] = {
+  1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+};
+
+/* Parse the decimal digits at *PTR, stopping before END, and advance
+ * *PTR past them.  While there are 8 bytes to look at, the length of
+ * the number is found with a single load. */
+static uintmax_t parse_digits(const char **ptr, const char *end) {
+  const char *p = *ptr;
+  uintmax_t value = 0;
+  uint64_t d, nondigit;
+  unsigned n, i;
+
+  while(end - p >= 8) {
+    d = load8(p) ^ (ONES * '0');
+    /* A byte is a digit if it is now less than 10 */
+    nondigit = ((((d & ~HIGHS) + ONES * (0x80 - 10)) | d) & HIGHS);
+    n = nondigit ? (unsigned)__builtin_ctzll(nondigit) / 8 : 8;
+    if(n < 4) {
+      /* Short fields are the most common, and are cheaper to do a
+       * byte at a time */
+      for(i = 0; i < n; ++i)
+        value = value * 10 + (p[i] - '0');
+    } else
+      value = value * powers[n] + convert8(d, n);
+    p += n;
+    if(n < 8) {
+      *ptr = p;
+      return value;
+    }
+  }
+  while(p < end && *p >= '0' && *p <= '9')
+    value = value * 10 + (*p++ - '0');
+  *ptr = p;
+  return value;
+}
+
+size_t stat_parse(const char *buf, size_t len, struct stat_line *sl,
+                  void *base, const struct stat_field *fields,
+                  size_t nfields) {
+  const char *ptr, *end, *close;
+  size_t field = 0;
+  uintmax_t value;
+  char *dest;
+  int negative;
+
+  memset(sl, 0, sizeof *sl);
+  if((end = memchr(buf, '\n', len)))
+    len = end - buf;
+  if((end = memchr(buf, 0, len)))
+    len = end - buf;
+  end = buf + len;
+  /* pid */
+  ptr = buf;
+  while(ptr < end && *ptr == ' ')
+    ++ptr;
+  if(ptr == end)
+    return 0;
+  while(ptr < end && *ptr != ' ')
+    ++ptr;
+  while(ptr < end && *ptr == ' ')
+    ++ptr;
+  if(ptr == end)
+    return 0;
+  /* comm, which may contain anything, including ')' */
+  if(*ptr == '(')
+    ++ptr;
+  sl->comm = ptr;
+  if(!(close = memrchr(ptr, ')', end - ptr)))
+    close = end;
+  sl->commlen = close - ptr;
+  ptr = close < end ? close + 1 : end;
+  /* state */
+  while(ptr < end && *ptr == ' ')
+    ++ptr;
+  if(ptr == end)
+    return 0;
+  sl->state = (unsigned char)*ptr++;
+  /* Numeric fields */
+  for(;;) {
+    while(ptr < end && *ptr == ' ')
+      ++ptr;
+    if(ptr == end)
+      break;
+    if((negative = (*ptr == '-')))
+      ++ptr;
+    value = parse_digits(&ptr, end);
+    if(negative)
+      value = -value;
+    /* Skip anything unexpected */
+    while(ptr < end && *ptr != ' ')
+      ++ptr;
+    if(field < nfields && fields[field].size) {
+      dest = (char *)base + fields[field].offset;
+      if(fields[field].size == sizeof (int))
+        *(int *)dest = value;
+      else
+        *(uintmax_t *)dest = value;
+    }
+    ++field;
+  }
+  return field;
+}
@@ -0,0 +1,76 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#ifndef STATPARSE_H
+#define STATPARSE_H
+
+/** @file statparse.h
+ * @brief Parser for /proc/PID/stat
+ */
+
+#include <stddef.h>
+
+/** @brief Where to store one numeric field of a stat line */
+struct stat_field {
+  /** @brief Offset of destination from the base pointer */
+  size_t offset;
+
+  /** @brief Size of destination
+   *
+   * This is either <tt>sizeof (int)</tt>, <tt>sizeof (uintmax_t)</tt>
+   * or 0 to discard the field.
+   */
+  size_t size;
+};
+
+/** @brief Non-numeric fields of a stat line */
+struct stat_line {
+  /** @brief Start of command name, or NULL if there was none */
+  const char *comm;
+
+  /** @brief Length of command name */
+  size_t commlen;
+
+  /** @brief State character, or 0 if there was none */
+  int state;
+};
+
+/** @brief Parse a stat line
+ * @param buf Contents of stat file
+ * @param len Length of @p buf
+ * @param sl Where to store non-numeric fields
+ * @param base Base pointer for numeric fields
+ * @param fields Destinations of numeric fields
+ * @param nfields Number of entries in @p fields
+ * @return Number of numeric fields found
+ *
+ * Parsing stops at the first newline or 0 byte, or at @p len.  The
+ * command name extends to the last ')' on the line, so it may
+ * itself contain spaces and parentheses.
+ *
+ * Numeric fields are the ones after the state character.  Field @c
+ * n is stored at @p base + @p fields[n].offset; fields beyond @p
+ * nfields are counted but discarded.  As with strtoumax(), a
+ * leading '-' negates the value.
+ */
+size_t stat_parse(const char *buf, size_t len, struct stat_line *sl,
+                  void *base, const struct stat_field *fields,
+                  size_t nfields);
+
+#endif /* STATPARSE_H */
@@ -0,0 +1,64 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "arena.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+int main() {
+  struct arena a[1], b[1];
+  char *strings[10000], buffer[32], *big;
+  uintmax_t *u;
+  size_t n;
+
+  memset(a, 0, sizeof *a);
+  memset(b, 0, sizeof *b);
+  assert(arena_alloc(a, 0) == NULL);
+  assert(arena_calloc(a, 0, 8) == NULL);
+
+  /* Enough strings to need several chunks, in two arenas */
+  for(n = 0; n < 10000; ++n) {
+    snprintf(buffer, sizeof buffer, "string %zu", n);
+    strings[n] = arena_strdup(n % 2 ? b : a, buffer);
+    assert(((uintptr_t)strings[n] % sizeof (uintmax_t)) == 0);
+  }
+  assert(!strcmp(arena_strndup(a, "spong", 3), "spo"));
+
+  /* Large allocations don't disturb the current chunk */
+  big = arena_alloc(a, 1 << 20);
+  memset(big, 'x', 1 << 20);
+  u = arena_calloc(a, 4, sizeof *u);
+  for(n = 0; n < 4; ++n)
+    assert(u[n] == 0);
+
+  /* Merged allocations survive until the destination is freed */
+  arena_merge(a, b);
+  assert(b->chunks == NULL);
+  for(n = 0; n < 10000; ++n) {
+    snprintf(buffer, sizeof buffer, "string %zu", n);
+    assert(!strcmp(strings[n], buffer));
+  }
+  assert(big[0] == 'x' && big[(1 << 20) - 1] == 'x');
+  arena_free(a);
+  assert(a->chunks == NULL);
+  return 0;
+}
@@ -82,6 +82,15 @@ int main() {
   assert(b->pos == 52);
   assert(b->pos < b->size);
 
+  b->pos = 2;
+  buffer_pad(b, ' ', 0);
+  assert(b->pos == 2);
+  buffer_pad(b, '-', 100);
+  assert(b->pos == 102);
+  assert(b->pos <= b->size);
+  assert(!strncmp(b->base, "ab----------", 12));
+  assert(b->base[101] == '-');
+
   b->pos = 0;
   gmtime_r(&zero, &t);
   buffer_strftime(b, "", &t);
@@ -68,6 +68,18 @@ int main() {
   assert(bytes(1024LL * 1024 * 1024 * 1024 * 1024, 20, 'M', output, sizeof output, 1) == output);
   assert(!strcmp(output, "          1073741824"));
 
+  assert(bytes(1024LL * 1024 * 1024 * 1024 * 1024, -12, 'M', output, sizeof output, 1) == output);
+  assert(!strcmp(output, "1073741824  "));
+
+  assert(bytes(3 * 1024 * 1024, 9, 0, output, sizeof output, 1) == output);
+  assert(!strcmp(output, "       3M"));
+
+  assert(bytes(3 * 1024 * 1024, 0, -'K', output, sizeof output, 1) == output);
+  assert(!strcmp(output, "3072K"));
+
+  assert(bytes(1024LL * 1024 * 1024 * 1024 * 1024, 20, 'M', output, 6, 1) == output);
+  assert(!strcmp(output, "     "));
+
   assert(bytes(16 * sysconf(_SC_PAGESIZE), 0, 'p', output, sizeof output, 1) == output);
   assert(!strcmp(output, "16"));
 
@@ -0,0 +1,169 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "tasks.h"
+#include "selectors.h"
+#include "utils.h"
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+static int gate[2];
+static pid_t thread_id;
+
+static void wait_gate(void) {
+  char c;
+  while(read(gate[0], &c, 1) < 0 && errno == EINTR)
+    ;
+}
+
+static void *thread_main(void attribute((unused)) *u) {
+  thread_id = syscall(SYS_gettid);
+  wait_gate();
+  return NULL;
+}
+
+/* Returned when a full scan is needed */
+#define FULL_SCAN ((size_t)-1)
+
+/* Find candidates for a single selector.  Returns FULL_SCAN if not
+ * possible, otherwise the number of candidates. */
+static size_t candidates_args(select_function *sfn, union arg *args,
+                              size_t nargs, int threads, pid_t **result) {
+  struct select_candidates c;
+
+  select_clear();
+  select_add(sfn, args, nargs);
+  memset(&c, 0, sizeof c);
+  c.threads = threads;
+  if((c.procfd = open(proc, O_RDONLY|O_DIRECTORY|O_CLOEXEC)) < 0)
+    fatal(errno, "opening %s", proc);
+  if(!select_candidates(&c))
+    c.npids = FULL_SCAN;
+  close(c.procfd);
+  select_clear();
+  *result = c.pids;
+  return c.npids;
+}
+
+/* Find candidates for a single process ID selector */
+static size_t candidates(select_function *sfn, pid_t *pids, size_t npids,
+                         pid_t **result) {
+  union arg *args;
+  size_t n;
+
+  args = xrecalloc(NULL, npids, sizeof *args);
+  for(n = 0; n < npids; ++n)
+    args[n].pid = pids[n];
+  n = candidates_args(sfn, args, npids, 0, result);
+  free(args);
+  return n;
+}
+
+int main() {
+  pid_t self = getpid(), child, grandchild, pids[2], *result;
+  union arg uid;
+  int relay[2], w;
+  pthread_t thread;
+  size_t n, i;
+
+  if(pipe(gate) < 0 || pipe(relay) < 0)
+    fatal(errno, "pipe");
+  if((child = fork()) < 0)
+    fatal(errno, "fork");
+  if(!child) {
+    close(gate[1]);
+    if((grandchild = fork()) < 0)
+      fatal(errno, "fork");
+    if(grandchild) {
+      if(write(relay[1], &grandchild, sizeof grandchild) < 0)
+        fatal(errno, "write");
+      wait_gate();
+      waitpid(grandchild, &w, 0);
+    } else
+      wait_gate();
+    _exit(0);
+  }
+  if(read(relay[0], &grandchild, sizeof grandchild) != sizeof grandchild)
+    fatal(errno, "read");
+  if((errno = pthread_create(&thread, NULL, thread_main, NULL)))
+    fatal(errno, "pthread_create");
+  while(!__atomic_load_n(&thread_id, __ATOMIC_SEQ_CST))
+    usleep(1000);
+
+  /* Processes are candidates but threads are not */
+  pids[0] = self;
+  pids[1] = thread_id;
+  n = candidates(select_pid, pids, 2, &result);
+  assert(n == 1 && result[0] == self);
+  free(result);
+
+  /* Owner candidates include this process, but a thread's owner can't
+   * be seen */
+  uid.uid = geteuid();
+  n = candidates_args(select_euid, &uid, 1, 0, &result);
+  assert(n > 0);
+  for(i = 0; i < n && result[i] != self; ++i)
+    ;
+  assert(i < n);
+  free(result);
+  assert(candidates_args(select_euid, &uid, 1, 1, &result) == FULL_SCAN);
+
+  /* Selectors without candidates */
+  assert(candidates(select_all, NULL, 0, &result) == FULL_SCAN);
+
+  /* Children and descendants need the children files */
+  n = candidates(select_ppid, &self, 1, &result);
+  if(n == FULL_SCAN) {
+    close(gate[1]);
+    waitpid(child, &w, 0);
+    return 77;                  /* skip */
+  }
+  assert(n == 1 && result[0] == child);
+  free(result);
+  n = candidates(select_apid, &self, 1, &result);
+  assert(n == 3);
+  for(n = 0; n < 3; ++n)
+    assert(result[n] == self || result[n] == child || result[n] == grandchild);
+  free(result);
+
+  /* Arguments that aren't processes can still be parents or ancestors
+   * (e.g. 0), so they need a full scan */
+  pids[0] = 0;
+  assert(candidates(select_ppid, pids, 1, &result) == FULL_SCAN);
+  assert(candidates(select_apid, pids, 1, &result) == FULL_SCAN);
+  pids[0] = self;
+  pids[1] = thread_id;
+  assert(candidates(select_apid, pids, 2, &result) == FULL_SCAN);
+
+  /* Release everything */
+  close(gate[1]);
+  if((errno = pthread_join(thread, NULL)))
+    fatal(errno, "pthread_join");
+  if(waitpid(child, &w, 0) < 0)
+    fatal(errno, "waitpid");
+  return 0;
+}
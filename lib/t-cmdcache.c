@@ -0,0 +1,119 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "tasks.h"
+#include "selectors.h"
+#include "utils.h"
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+static int command[2], reply[2];
+
+static void child(char *argv0) {
+  char c;
+  /* Make sure we see EOF if the parent dies */
+  close(command[1]);
+  close(reply[0]);
+  for(;;) {
+    if(read(command[0], &c, 1) <= 0)
+      _exit(0);
+    switch(c) {
+    case 'm':                   /* modify command line */
+      argv0[0] = 'X';
+      break;
+    case 'e':                   /* replace process */
+      execl("/bin/sleep", "sleep", "60", (char *)NULL);
+      _exit(1);
+    }
+    if(write(reply[1], &c, 1) < 0)
+      _exit(1);
+  }
+}
+
+static void send_command(char c) {
+  if(write(command[1], &c, 1) < 0)
+    fatal(errno, "write");
+  if(c != 'e' && read(reply[0], &c, 1) != 1)
+    fatal(errno, "read");
+}
+
+static struct taskinfo *snapshot(struct taskinfo *last) {
+  struct taskinfo *ti = task_enumerate(last, TASK_PROCESSES);
+  task_free(last);
+  return ti;
+}
+
+int main(int attribute((unused)) argc, char **argv) {
+  struct taskinfo *ti;
+  taskident taskid;
+  char *original;
+  int w, n;
+
+  if(pipe(command) < 0 || pipe(reply) < 0)
+    fatal(errno, "pipe");
+  if((taskid.pid = fork()) < 0)
+    fatal(errno, "fork");
+  if(!taskid.pid)
+    child(argv[0]);
+  close(command[0]);
+  close(reply[1]);
+  taskid.tid = -1;
+  select_add(select_all, NULL, 0);
+
+  /* The command line can only be carried over if stat was read too */
+  ti = snapshot(NULL);
+  task_get_comm(ti, taskid);
+  original = xstrdup(task_get_cmdline(ti, taskid));
+  assert(!strncmp(original, argv[0], strlen(argv[0])));
+
+  /* The command line is carried over while the process stays the same */
+  send_command('m');
+  ti = snapshot(ti);
+  assert(!strcmp(task_get_cmdline(ti, taskid), original));
+
+  /* ...but is eventually read again */
+  for(n = 0; n < 20 && !strcmp(task_get_cmdline(ti, taskid), original); ++n)
+    ti = snapshot(ti);
+  assert(n < 20);
+  assert(task_get_cmdline(ti, taskid)[0] == 'X');
+
+  /* After execve() the new command line is picked up at once */
+  send_command('e');
+  for(n = 0; n < 1000; ++n) {
+    ti = snapshot(ti);
+    if(!strcmp(task_get_comm(ti, taskid), "sleep"))
+      break;
+    usleep(10000);
+  }
+  assert(n < 1000);
+  assert(!strcmp(task_get_cmdline(ti, taskid), "sleep 60"));
+
+  task_free(ti);
+  free(original);
+  kill(taskid.pid, SIGKILL);
+  if(waitpid(taskid.pid, &w, 0) < 0)
+    fatal(errno, "waitpid");
+  return 0;
+}
@@ -0,0 +1,148 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "tasks.h"
+#include "selectors.h"
+#include "utils.h"
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define ROUNDS 8
+#define CHILDREN 32
+#define THREADS 4
+
+static int gate[2];
+static pid_t children[ROUNDS * CHILDREN];
+static size_t nchildren;
+
+static void *thread_main(void attribute((unused)) *u) {
+  char c;
+  while(read(gate[0], &c, 1) < 0 && errno == EINTR)
+    ;
+  return NULL;
+}
+
+/* Nonzero if PID is us or one of our children */
+static int ours(pid_t pid) {
+  size_t n;
+  if(pid == getpid())
+    return 1;
+  for(n = 0; n < nchildren; ++n)
+    if(children[n] == pid)
+      return 1;
+  return 0;
+}
+
+/* Return the sorted list of tasks in TI that belong to us */
+static taskident *our_tasks(struct taskinfo *ti, size_t *np) {
+  taskident *tasks;
+  size_t n, k;
+
+  tasks = task_get_all(ti, np, TASK_PROCESSES|TASK_THREADS);
+  for(n = k = 0; n < *np; ++n)
+    if(ours(tasks[n].pid))
+      tasks[k++] = tasks[n];
+  *np = k;
+  return tasks;
+}
+
+/* Check that TI agrees with a full scan about our tasks */
+static void check(struct taskinfo *ti) {
+  struct taskinfo *scan;
+  taskident *a, *b;
+  size_t na, nb, n;
+
+  scan = task_enumerate(NULL, TASK_PROCESSES|TASK_THREADS);
+  a = our_tasks(ti, &na);
+  b = our_tasks(scan, &nb);
+  assert(na == nb);
+  for(n = 0; n < na; ++n) {
+    assert(a[n].pid == b[n].pid);
+    assert(a[n].tid == b[n].tid);
+  }
+  free(a);
+  free(b);
+  task_free(scan);
+}
+
+int main() {
+  struct taskinfo *ti, *last;
+  pthread_t threads[THREADS];
+  size_t round, n;
+  pid_t pid;
+  int w;
+
+  select_add(select_all, NULL, 0);
+  ti = task_enumerate(NULL, TASK_PROCESSES|TASK_THREADS|TASK_EVENTS);
+  if(!task_events())
+    return 77;                  /* skip */
+  if(pipe(gate) < 0)
+    fatal(errno, "pipe");
+  for(round = 0; round < ROUNDS; ++round) {
+    /* Half the children exit straight away; the rest wait */
+    for(n = 0; n < CHILDREN; ++n) {
+      if((pid = fork()) < 0)
+        fatal(errno, "fork");
+      if(!pid) {
+        close(gate[1]);
+        if(n % 2)
+          thread_main(NULL);
+        _exit(0);
+      }
+      children[nchildren++] = pid;
+    }
+    for(n = 0; n < nchildren; n += 2)
+      if(children[n] > 0) {
+        if(waitpid(children[n], &w, 0) < 0)
+          fatal(errno, "waitpid");
+        children[n] = -children[n];
+      }
+    if(round == ROUNDS / 2)
+      for(n = 0; n < THREADS; ++n)
+        if((errno = pthread_create(&threads[n], NULL, thread_main, NULL)))
+          fatal(errno, "pthread_create");
+    last = ti;
+    ti = task_enumerate(last, TASK_PROCESSES|TASK_THREADS|TASK_EVENTS);
+    task_free(last);
+    check(ti);
+  }
+  /* Release everything */
+  close(gate[1]);
+  for(n = 0; n < THREADS; ++n)
+    if((errno = pthread_join(threads[n], NULL)))
+      fatal(errno, "pthread_join");
+  for(n = 0; n < nchildren; ++n)
+    if(children[n] > 0) {
+      if(waitpid(children[n], &w, 0) < 0)
+        fatal(errno, "waitpid");
+    } else
+      children[n] = -children[n];
+  last = ti;
+  ti = task_enumerate(last, TASK_PROCESSES|TASK_THREADS|TASK_EVENTS);
+  task_free(last);
+  check(ti);
+  task_free(ti);
+  return 0;
+}
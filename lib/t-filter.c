@@ -0,0 +1,86 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "tasks.h"
+#include "selectors.h"
+#include "testdata.h"
+#include "utils.h"
+#include <assert.h>
+#include <stdlib.h>
+
+static struct taskinfo *ti;
+
+/* Evaluate a single match expression */
+static int match(const char *expr, taskident task) {
+  select_function *sfn;
+  union arg *args;
+  size_t nargs;
+  int rc;
+  sfn = select_match_compile(expr, &args, &nargs);
+  rc = !!sfn(ti, task, args, nargs);
+  select_match_free(sfn, args, nargs);
+  return rc;
+}
+
+static int filter(const char *expr, taskident task) {
+  int rc;
+  select_filter_clear();
+  select_filter(expr);
+  rc = select_test(ti, task);
+  select_filter_clear();
+  return rc;
+}
+
+int main() {
+  taskident *tasks, t;
+  size_t ntasks, n;
+  int a, b, c;
+
+  ti = testdata_tasks(TASK_PROCESSES, &tasks, &ntasks);
+  for(n = 0; n < ntasks; ++n) {
+    t = tasks[n];
+    a = match("rss>=1M", t);
+    b = match("comm=udevd", t);
+    c = match("pss>100K", t);
+    assert(filter("rss>=1M", t) == a);
+    assert(filter("not rss>=1M", t) == !a);
+    assert(filter("not not rss>=1M", t) == a);
+    assert(filter("rss>=1M and comm=udevd", t) == (a && b));
+    assert(filter("rss>=1M or comm=udevd", t) == (a || b));
+    assert(filter("pss>100K and not (rss>=1M or comm=udevd)", t)
+           == (c && !(a || b)));
+    assert(filter("pss>100K or rss>=1M and comm=udevd", t)
+           == (c || (a && b)));
+    assert(filter("not pss>100K and comm=udevd", t) == (!c && b));
+    assert(filter("((comm=udevd))", t) == b);
+    assert(filter("'comm=udevd' and \"rss>=1M\"", t) == (a && b));
+    /* Multiple filters must all pass */
+    select_filter("rss>=1M");
+    select_filter("comm=udevd");
+    assert(select_test(ti, t) == (a && b));
+    select_filter_clear();
+  }
+  /* Only cheap sources are prefetched */
+  select_filter("pss>100K and rss>=1M");
+  assert(select_filter_sources() == TASK_SRC_STAT);
+  select_filter_clear();
+  testdata_free(ti, tasks);
+  return 0;
+}
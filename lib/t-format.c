@@ -72,7 +72,9 @@
 
 int main() {
   struct buffer b[1];
-  time_t today, thisyear;
+  time_t today, thisyear, when;
+  char expected[64];
+  int n;
   struct tm t;
   sigset_t ss;
 
@@ -96,6 +98,17 @@ int main() {
   INTEGER(127, 'x', "7f");
   INTEGER(127, 'X', "7F");
   INTEGER(127, 'o', "177");
+  INTEGER(0, 'd', "0");
+  INTEGER(9, 'd', "9");
+  INTEGER(10, 'd', "10");
+  INTEGER(99, 'd', "99");
+  INTEGER(12345, 'd', "12345");
+  INTEGER(INTMAX_MAX, 'd', "9223372036854775807");
+  INTEGER(INTMAX_MIN, 'd', "-9223372036854775808");
+  INTEGER(-1, 'u', "18446744073709551615");
+  INTEGER(-1, 'x', "ffffffffffffffff");
+  INTEGER(-1, 'o', "1777777777777777777777");
+  INTEGER(0, 'x', "0");
 
   ADDRESS(0x00000000000000FFULL, "000000ff");
   ADDRESS(0x000000FF000000FFULL, "00ff000000ff");
@@ -146,6 +159,27 @@ int main() {
   TIME(today + 3 * 3600 + 4 * 60 + 5, 0, NULL, 0, "03:04");
   TIME(0, SIZE_MAX, NULL, 0, "1970-01-01");
   TIME(thisyear + 3600, 0, NULL, 0, "01-01");
+  /* Repeated conversions within one day */
+  TIME(today + 86399, SIZE_MAX, NULL, 0, "23:59:59");
+  TIME(today, SIZE_MAX, NULL, 0, "00:00:00");
+  TIME(15638400 + 12 * 3600 + 34 * 60 + 56, 32, NULL, 0,
+       "1970-07-01T12:34:56");
+  TIME(15638400 + 86399, 32, NULL, 0, "1970-07-01T23:59:59");
+  /* Rows from earlier days, interleaved with rows from today */
+  for(n = 0; n < 40; ++n) {
+    when = today - (n % 5 + 1) * 86400 + n * 1000;
+    gmtime_r(&when, &t);
+    strftime(expected, sizeof expected, "%Y-%m-%d", &t);
+    TIME(when, SIZE_MAX, NULL, 0, expected);
+    strftime(expected, sizeof expected, "%Y-%m-%dT%H:%M:%S", &t);
+    TIME(when, 32, NULL, 0, expected);
+    when = today + n * 1000;
+    gmtime_r(&when, &t);
+    strftime(expected, sizeof expected, "%H:%M:%S", &t);
+    TIME(when, SIZE_MAX, NULL, 0, expected);
+  }
+  TIME(15638400 + 86400, 32, NULL, 0, "1970-07-02T00:00:00");
+  TIME(15638400 - 1, 32, NULL, 0, "1970-06-30T23:59:59");
 
   TIME(15638400, 32, NULL, FORMAT_RAW, "15638400");
 
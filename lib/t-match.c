@@ -0,0 +1,104 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "tasks.h"
+#include "selectors.h"
+#include "format.h"
+#include "compare.h"
+#include "buffer.h"
+#include "testdata.h"
+#include "utils.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *const properties[] = {
+  "pid", "ppid", "pgrp", "nice", "pri", "rtprio", "threads", "uid", "gid",
+  "rss", "vsz", "pss", "io", "read", "oom", "time", "etime", "pcpu",
+  "tty", "comm", "user", "state",
+};
+#define NPROPERTIES (sizeof properties / sizeof *properties)
+
+static const char *const operators[] = {
+  "<", "<=", ">", ">=", "==", "!=", "<>",
+};
+#define NOPERATORS (sizeof operators / sizeof *operators)
+
+static const char *const values[] = {
+  "0", "1", "10", "358", "1K", "2M", "1KM", "4p", "0x10", "010", "08",
+  "abc", "-1", "5K5", "", "99999999999999999999999",
+};
+#define NVALUES (sizeof values / sizeof *values)
+
+/* Evaluate a comparison the slow way */
+static int expect(struct taskinfo *ti, taskident task, const char *property,
+                  const char *op, const char *value) {
+  struct buffer b[1];
+  int c;
+  buffer_init(b);
+  format_value(ti, task, property, b, FORMAT_RAW);
+  c = qlcompare(b->base, value);
+  free(b->base);
+  if(!strcmp(op, "<")) return c < 0;
+  if(!strcmp(op, "<=")) return c <= 0;
+  if(!strcmp(op, ">")) return c > 0;
+  if(!strcmp(op, ">=")) return c >= 0;
+  if(!strcmp(op, "==")) return c == 0;
+  return c != 0;
+}
+
+int main() {
+  struct taskinfo *ti;
+  taskident *tasks;
+  size_t ntasks, n, p, o, v;
+  char *expr;
+  select_function *sfn;
+  union arg *args;
+  size_t nargs;
+
+  ti = testdata_tasks(TASK_PROCESSES|TASK_THREADS, &tasks, &ntasks);
+  for(p = 0; p < NPROPERTIES; ++p)
+    for(o = 0; o < NOPERATORS; ++o)
+      for(v = 0; v < NVALUES; ++v) {
+        xasprintf(&expr, "%s%s%s", properties[p], operators[o], values[v]);
+        sfn = select_match_compile(expr, &args, &nargs);
+        for(n = 0; n < ntasks; ++n)
+          assert(!!sfn(ti, tasks[n], args, nargs)
+                 == expect(ti, tasks[n], properties[p], operators[o],
+                           values[v]));
+        select_match_free(sfn, args, nargs);
+        free(expr);
+      }
+  /* String and regexp matches */
+  select_clear();
+  select_match("comm=udevd");
+  select_match("comm~^KWORK");
+  for(n = 0; n < ntasks; ++n) {
+    struct buffer b[1];
+    buffer_init(b);
+    format_value(ti, tasks[n], "comm", b, 0);
+    assert(select_test(ti, tasks[n])
+           == (!strcmp(b->base, "udevd") || !strncasecmp(b->base, "kwork", 5)));
+    free(b->base);
+  }
+  testdata_free(ti, tasks);
+  return 0;
+}
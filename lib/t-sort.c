@@ -0,0 +1,132 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "sort.h"
+#include "format.h"
+#include "tasks.h"
+#include "testdata.h"
+#include "user.h"
+#include "utils.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const uint64_t *test_keys;
+static size_t test_nwords;
+
+/* Reference comparison: keys, then record number for stability */
+static int compare_records(const void *av, const void *bv) {
+  size_t a = *(const size_t *)av, b = *(const size_t *)bv, w;
+  for(w = 0; w < test_nwords; ++w)
+    if(test_keys[a * test_nwords + w] != test_keys[b * test_nwords + w])
+      return (test_keys[a * test_nwords + w]
+              < test_keys[b * test_nwords + w] ? -1 : 1);
+  return a < b ? -1 : a > b;
+}
+
+static void test_keysort(size_t nrecords, size_t nwords, uint64_t mask,
+                         unsigned workers) {
+  uint64_t *keys;
+  size_t *order, *expect, n, k;
+
+  keys = xrecalloc(NULL, nrecords * nwords + 1, sizeof *keys);
+  for(n = 0; n < nrecords * nwords; ++n)
+    keys[n] = ((uint64_t)random() << 33 ^ (uint64_t)random() << 11
+               ^ (uint64_t)random()) & mask;
+  order = xrecalloc(NULL, nrecords + 1, sizeof *order);
+  expect = xrecalloc(NULL, nrecords + 1, sizeof *expect);
+  for(n = 0; n < nrecords; ++n)
+    expect[n] = n;
+  test_keys = keys;
+  test_nwords = nwords;
+  qsort(expect, nrecords, sizeof *expect, compare_records);
+  keysort(order, keys, nrecords, nwords, workers);
+  assert(!memcmp(order, expect, nrecords * sizeof *order));
+  /* Selection agrees with the start of the sorted order */
+  for(k = 0; k <= nrecords + 1; k = 2 * k + 1) {
+    assert(keyselect(order, keys, nrecords, nwords, k) == min(k, nrecords));
+    assert(!memcmp(order, expect, min(k, nrecords) * sizeof *order));
+  }
+  free(expect);
+  free(order);
+  free(keys);
+}
+
+static struct taskinfo *ti;
+
+static int compare_tasks(const void *av, const void *bv) {
+  return format_compare(ti, *(const taskident *)av, *(const taskident *)bv);
+}
+
+static void test_format_sort(const char *ordering,
+                             const taskident *tasks, size_t ntasks) {
+  taskident *sorted, *expect;
+  size_t k, nsorted;
+
+  sorted = xrecalloc(NULL, ntasks, sizeof *sorted);
+  expect = xrecalloc(NULL, ntasks, sizeof *expect);
+  memcpy(sorted, tasks, ntasks * sizeof *tasks);
+  memcpy(expect, tasks, ntasks * sizeof *tasks);
+  assert(format_ordering(ordering, FORMAT_INTERNAL));
+  qsort(expect, ntasks, sizeof *expect, compare_tasks);
+  format_sort(ti, sorted, ntasks);
+  assert(!memcmp(sorted, expect, ntasks * sizeof *sorted));
+  for(k = 0; k <= ntasks + 1; ++k) {
+    memcpy(sorted, tasks, ntasks * sizeof *tasks);
+    nsorted = format_select(ti, sorted, ntasks, k);
+    assert(nsorted >= min(k, ntasks) && nsorted <= ntasks);
+    assert(!memcmp(sorted, expect, nsorted * sizeof *sorted));
+  }
+  free(expect);
+  free(sorted);
+}
+
+int main() {
+  static const char *const orderings[] = {
+    "", "pid", "-pid", "ppid,-tid", "rss", "-rss,vsize", "comm",
+    "-comm,pid", "args", "user", "-group", "ruser,rgroup,nice", "pcpu",
+    "+state,-pmem", "_hier", "-_hier", "_hier,-rss", "tty,uid", "supgid",
+    "sigcaught,comm",
+  };
+  static const size_t sizes[] = { 0, 1, 2, 31, 32, 33, 1000, 5000 };
+  taskident *tasks;
+  size_t ntasks, n, w;
+  char *users, *groups;
+
+  for(n = 0; n < sizeof sizes / sizeof *sizes; ++n)
+    for(w = 1; w <= 3; ++w) {
+      test_keysort(sizes[n], w, UINT64_MAX, 0);
+      test_keysort(sizes[n], w, 0xF00F, 0);
+      test_keysort(sizes[n], w, 0, 0);
+    }
+  /* Large enough to be split into runs and merged */
+  test_keysort(300000, 2, 0xFFFF00FF, 3);
+  test_keysort(300000, 1, UINT64_MAX, 4);
+
+  forceusers = users = testdata_path("passwd");
+  forcegroups = groups = testdata_path("group");
+  ti = testdata_tasks(TASK_PROCESSES|TASK_THREADS, &tasks, &ntasks);
+  for(n = 0; n < sizeof orderings / sizeof *orderings; ++n)
+    test_format_sort(orderings[n], tasks, ntasks);
+  testdata_free(ti, tasks);
+  free(groups);
+  free(users);
+  return 0;
+}
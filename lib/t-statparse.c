@@ -0,0 +1,190 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "statparse.h"
+#include "utils.h"
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NFIELDS 48
+
+struct values {
+  int i[NFIELDS];
+  uintmax_t u[NFIELDS];
+};
+
+static struct stat_field fields[NFIELDS];
+
+/* The straightforward parser that stat_parse() replaced (with the
+ * command name extended to the last ')') */
+static size_t reference(char *buf, struct stat_line *sl, struct values *v) {
+  char *bp = buf, *start, *close;
+  size_t field = 0;
+  uintmax_t value;
+
+  memset(sl, 0, sizeof *sl);
+  while(*bp && *bp != '\n') {
+    if(*bp == ' ') {
+      ++bp;
+      continue;
+    }
+    switch(field) {
+    default:
+      value = strtoumax(bp, &bp, 10);
+      if(field - 3 < NFIELDS && fields[field - 3].size) {
+        if(fields[field - 3].size == sizeof (int))
+          v->i[field - 3] = value;
+        else
+          v->u[field - 3] = value;
+      }
+      break;
+    case 0:                   /* pid */
+      while(*bp && *bp != ' ')
+        ++bp;
+      break;
+    case 1:                   /* comm */
+      if(*bp == '(')
+        ++bp;
+      start = bp;
+      close = NULL;
+      while(*bp && *bp != '\n') {
+        if(*bp == ')')
+          close = bp;
+        ++bp;
+      }
+      if(close)
+        bp = close;
+      sl->comm = start;
+      sl->commlen = bp - start;
+      if(*bp == ')')
+        ++bp;
+      break;
+    case 2:                   /* state */
+      sl->state = (unsigned char)*bp++;
+      break;
+    }
+    field++;
+  }
+  return field > 3 ? field - 3 : 0;
+}
+
+static uint64_t state = 88172645463325252;
+
+static uint64_t xorshift(void) {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+static uintmax_t random_value(void) {
+  static const uintmax_t special[] = {
+    0, 9, 10, 99999999, 100000000, 4294967295, 4294967296,
+    UINT64_C(9999999999999999), UINT64_C(10000000000000000000),
+    UINT64_MAX,
+  };
+  switch(xorshift() % 4) {
+  case 0: return xorshift() % 1000;
+  case 1: return special[xorshift() % (sizeof special / sizeof *special)];
+  case 2: return xorshift() >> (xorshift() % 64);
+  default: return xorshift();
+  }
+}
+
+static size_t random_line(char *buf, size_t size) {
+  static const char comm_chars[] = "abc ()) (:-/0123456789";
+  size_t n = 0, i, len, nnumbers;
+
+  n += snprintf(buf + n, size - n, "%u (", (unsigned)(xorshift() % 4194304));
+  len = xorshift() % 17;
+  for(i = 0; i < len; ++i)
+    buf[n++] = comm_chars[xorshift() % (sizeof comm_chars - 1)];
+  n += snprintf(buf + n, size - n, ") %c", "RSDZTtXI"[xorshift() % 8]);
+  nnumbers = xorshift() % 56;
+  for(i = 0; i < nnumbers; ++i) {
+    buf[n++] = ' ';
+    if(xorshift() % 16 == 0)
+      buf[n++] = ' ';
+    if(xorshift() % 8 == 0)
+      n += snprintf(buf + n, size - n, "-%ju", (uintmax_t)(xorshift() % 200));
+    else
+      n += snprintf(buf + n, size - n, "%ju", random_value());
+  }
+  if(xorshift() % 2)
+    buf[n++] = '\n';
+  buf[n] = 0;
+  return n;
+}
+
+static void check(const char *line, size_t len) {
+  struct stat_line sl, rsl;
+  struct values v, rv;
+  size_t count, rcount;
+  char *copy;
+
+  /* An exact-sized copy, to catch overruns */
+  copy = xstrndup(line, len);
+  memset(&v, 0, sizeof v);
+  memset(&rv, 0, sizeof rv);
+  count = stat_parse(copy, len, &sl, &v, fields, NFIELDS);
+  rcount = reference(copy, &rsl, &rv);
+  if(count != rcount
+     || sl.commlen != rsl.commlen
+     || (sl.comm && sl.comm - copy != rsl.comm - copy)
+     || sl.state != rsl.state
+     || memcmp(&v, &rv, sizeof v)) {
+    fprintf(stderr, "mismatch for: %s\n", line);
+    exit(1);
+  }
+  free(copy);
+}
+
+int main() {
+  char buf[2048];
+  size_t n, len;
+
+  for(n = 0; n < NFIELDS; ++n) {
+    switch(n % 3) {
+    case 0:
+      fields[n].offset = offsetof(struct values, i[n]);
+      fields[n].size = sizeof (int);
+      break;
+    case 1:
+      fields[n].offset = offsetof(struct values, u[n]);
+      fields[n].size = sizeof (uintmax_t);
+      break;
+    }
+  }
+  check("", 0);
+  check("1", 1);
+  check("1 (init) S 0 1 1 0 -1 4194560 43775 4849718 98 3217 127 418 "
+        "19087 3993 20 0 1 0 3 170934272 3278 18446744073709551615",
+        strlen("1 (init) S 0 1 1 0 -1 4194560 43775 4849718 98 3217 127 418 "
+               "19087 3993 20 0 1 0 3 170934272 3278 18446744073709551615"));
+  check("77 (a) b (c)) R 1 2\n", strlen("77 (a) b (c)) R 1 2\n"));
+  for(n = 0; n < 200000; ++n) {
+    len = random_line(buf, sizeof buf);
+    check(buf, len);
+  }
+  return 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "tasks.h"
+#include "general.h"
+#include "testdata.h"
+#include "utils.h"
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Expected values, parsed the slow way */
+struct expect {
+  unsigned long uids[4], gids[4];
+  uintmax_t peak, hwm, stk, lck, pin, pte, swap;
+  int have_swap;
+  gid_t groups[64];
+  size_t ngroups;
+  uint64_t sigs[4];             /* pending, blocked, ignored, caught */
+};
+
+static void expect(const char *path, struct expect *e) {
+  char line[1024], *ptr, *end;
+  FILE *fp;
+
+  memset(e, 0, sizeof *e);
+  if(!(fp = fopen(path, "r")))
+    fatal(errno, "opening %s", path);
+  while(fgets(line, sizeof line, fp)) {
+    sscanf(line, "Uid: %lu %lu %lu %lu",
+           &e->uids[0], &e->uids[1], &e->uids[2], &e->uids[3]);
+    sscanf(line, "Gid: %lu %lu %lu %lu",
+           &e->gids[0], &e->gids[1], &e->gids[2], &e->gids[3]);
+    sscanf(line, "VmPeak: %ju", &e->peak);
+    sscanf(line, "VmHWM: %ju", &e->hwm);
+    sscanf(line, "VmStk: %ju", &e->stk);
+    sscanf(line, "VmLck: %ju", &e->lck);
+    sscanf(line, "VmPin: %ju", &e->pin);
+    sscanf(line, "VmPTE: %ju", &e->pte);
+    if(sscanf(line, "VmSwap: %ju", &e->swap) == 1)
+      e->have_swap = 1;
+    sscanf(line, "SigPnd: %" SCNx64, &e->sigs[0]);
+    sscanf(line, "SigBlk: %" SCNx64, &e->sigs[1]);
+    sscanf(line, "SigIgn: %" SCNx64, &e->sigs[2]);
+    sscanf(line, "SigCgt: %" SCNx64, &e->sigs[3]);
+    if(!strncmp(line, "Groups:", 7)) {
+      ptr = line + 7;
+      for(;;) {
+        unsigned long g = strtoul(ptr, &end, 10);
+        if(end == ptr)
+          break;
+        assert(e->ngroups < 64);
+        e->groups[e->ngroups++] = g;
+        ptr = end;
+      }
+    }
+  }
+  fclose(fp);
+}
+
+static void check_sigs(const sigset_t *ss, uint64_t bits) {
+  int sig;
+  for(sig = 1; sig <= 64; ++sig)
+    /* glibc hides the signals it reserves for itself */
+    if(sig < 32 || sig >= SIGRTMIN)
+      assert(!!sigismember(ss, sig) == !!(bits & ((uint64_t)1 << (sig - 1))));
+}
+
+int main() {
+  struct taskinfo *ti;
+  taskident *tasks;
+  size_t ntasks, n, count;
+  struct expect e;
+  const gid_t *groups;
+  sigset_t ss;
+
+  ti = testdata_tasks(TASK_PROCESSES, &tasks, &ntasks);
+  for(n = 0; n < ntasks; ++n) {
+    char *status;
+    xasprintf(&status, "%s/%ld/status", proc, (long)tasks[n].pid);
+    expect(status, &e);
+    free(status);
+    /* Signals first, so that the other keys need a second parse */
+    task_get_sig_pending(ti, tasks[n], &ss);
+    check_sigs(&ss, e.sigs[0]);
+    task_get_sig_blocked(ti, tasks[n], &ss);
+    check_sigs(&ss, e.sigs[1]);
+    task_get_sig_ignored(ti, tasks[n], &ss);
+    check_sigs(&ss, e.sigs[2]);
+    task_get_sig_caught(ti, tasks[n], &ss);
+    check_sigs(&ss, e.sigs[3]);
+    assert(task_get_ruid(ti, tasks[n]) == e.uids[0]);
+    assert(task_get_euid(ti, tasks[n]) == e.uids[1]);
+    assert(task_get_suid(ti, tasks[n]) == e.uids[2]);
+    assert(task_get_fsuid(ti, tasks[n]) == e.uids[3]);
+    assert(task_get_rgid(ti, tasks[n]) == e.gids[0]);
+    assert(task_get_egid(ti, tasks[n]) == e.gids[1]);
+    assert(task_get_sgid(ti, tasks[n]) == e.gids[2]);
+    assert(task_get_fsgid(ti, tasks[n]) == e.gids[3]);
+    assert(task_get_peak_vsize(ti, tasks[n]) == e.peak * KILOBYTE);
+    assert(task_get_peak_rss(ti, tasks[n]) == e.hwm * KILOBYTE);
+    assert(task_get_stack(ti, tasks[n]) == e.stk * KILOBYTE);
+    assert(task_get_locked(ti, tasks[n]) == e.lck * KILOBYTE);
+    assert(task_get_pinned(ti, tasks[n]) == e.pin * KILOBYTE);
+    assert(task_get_pte(ti, tasks[n]) == e.pte * KILOBYTE);
+    if(e.have_swap)
+      assert(task_get_swap(ti, tasks[n]) == e.swap * KILOBYTE);
+    groups = task_get_supgids(ti, tasks[n], &count);
+    assert(count == e.ngroups);
+    assert(!count || !memcmp(groups, e.groups, count * sizeof *groups));
+  }
+  testdata_free(ti, tasks);
+  return 0;
+}
@@ -0,0 +1,63 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "taskindex.h"
+#include <assert.h>
+#include <stdint.h>
+
+int main() {
+  struct taskindex ix[1];
+  taskident id;
+  size_t n;
+
+  /* Start small so that the index has to grow */
+  taskindex_init(ix, 0);
+  for(n = 0; n < 100000; ++n) {
+    id.pid = n / 8 + 1;
+    id.tid = n % 8 ? (pid_t)n : -1;
+    taskindex_insert(ix, id, n);
+  }
+  assert(ix->count == 100000);
+  assert(ix->mask + 1 >= 2 * ix->count);
+  for(n = 0; n < 100000; ++n) {
+    id.pid = n / 8 + 1;
+    id.tid = n % 8 ? (pid_t)n : -1;
+    assert(taskindex_find(ix, id) == n);
+  }
+  /* Missing entries */
+  id.pid = 1;
+  id.tid = 0;
+  assert(taskindex_find(ix, id) == SIZE_MAX);
+  id.pid = 200000;
+  id.tid = -1;
+  assert(taskindex_find(ix, id) == SIZE_MAX);
+  /* Replacement */
+  id.pid = 1;
+  id.tid = -1;
+  taskindex_insert(ix, id, 99);
+  assert(taskindex_find(ix, id) == 99);
+  assert(ix->count == 100000);
+  taskindex_free(ix);
+  /* Empty index */
+  taskindex_init(ix, 0);
+  assert(taskindex_find(ix, id) == SIZE_MAX);
+  taskindex_free(ix);
+  return 0;
+}
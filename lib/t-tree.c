@@ -0,0 +1,123 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "tasks.h"
+#include "testdata.h"
+#include "utils.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static struct taskinfo *ti;
+
+/* Return the parent of PID, or -1 if it is a root */
+static pid_t parent(pid_t pid) {
+  taskident t = { pid, -1 }, p = { -1, -1 };
+  p.pid = task_get_ppid(ti, t);
+  if(p.pid == pid || task_get_tree_rank(ti, p) == SIZE_MAX)
+    return -1;
+  return p.pid;
+}
+
+/* Return the depth of PID, the slow way */
+static int depth(pid_t pid) {
+  int d = 0;
+  while((pid = parent(pid)) != -1)
+    ++d;
+  return d;
+}
+
+/* Return true if A is an ancestor of or equal to B, the slow way */
+static int ancestor(pid_t a, pid_t b) {
+  do {
+    if(a == b)
+      return 1;
+  } while((b = parent(b)) != -1);
+  return 0;
+}
+
+/* Return the ancestor of PID whose parent is P (-1 for roots) */
+static pid_t below(pid_t pid, pid_t p) {
+  pid_t q;
+  while((q = parent(pid)) != p) {
+    if(q == -1)
+      return -1;
+    pid = q;
+  }
+  return pid;
+}
+
+int main() {
+  taskident *tasks, *order;
+  size_t ntasks, nprocs = 0, n, r;
+  pid_t x, y, py, a;
+
+  ti = testdata_tasks(TASK_PROCESSES|TASK_THREADS, &tasks, &ntasks);
+  order = xrecalloc(NULL, ntasks, sizeof *order);
+  memset(order, 0, ntasks * sizeof *order);
+  for(n = 0; n < ntasks; ++n) {
+    taskident process = { tasks[n].pid, -1 };
+    r = task_get_tree_rank(ti, tasks[n]);
+    /* Threads share their process's position */
+    assert(r == task_get_tree_rank(ti, process));
+    assert(task_get_depth(ti, tasks[n]) == depth(tasks[n].pid));
+    if(tasks[n].tid == -1) {
+      assert(r < ntasks);
+      assert(order[r].pid == 0);
+      order[r] = tasks[n];
+      ++nprocs;
+    }
+  }
+  /* Positions are dense and form a preorder with siblings in PID order */
+  for(r = 1; r < nprocs; ++r) {
+    x = order[r - 1].pid;
+    y = order[r].pid;
+    assert(x && y);
+    py = parent(y);
+    if(py == x)
+      continue;
+    /* Y follows a sibling of X or of one of X's ancestors */
+    a = below(x, py);
+    assert(a != -1 || py == -1);
+    assert(a < y);
+  }
+  /* Ancestry agrees with walking up the tree */
+  for(n = 0; n < ntasks; ++n)
+    for(r = 0; r < ntasks; ++r)
+      assert(!!task_is_ancestor(ti, tasks[n], tasks[r])
+             == ancestor(tasks[n].pid, tasks[r].pid));
+  /* Ancestry reaches processes that were not enumerated */
+  for(n = 0; n < ntasks; ++n) {
+    taskident root = { tasks[n].pid, -1 }, none = { 0, -1 };
+    while((y = parent(root.pid)) != -1)
+      root.pid = y;
+    assert(!!task_is_ancestor(ti, none, tasks[n])
+           == (task_get_ppid(ti, root) == 0));
+  }
+  taskident missing = { 999999, -1 };
+  assert(task_get_tree_rank(ti, missing) == SIZE_MAX);
+  assert(task_get_depth(ti, missing) == -1);
+  assert(!task_is_ancestor(ti, missing, order[0]));
+  assert(!task_is_ancestor(ti, order[0], missing));
+  free(order);
+  testdata_free(ti, tasks);
+  return 0;
+}
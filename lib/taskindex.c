@@ -0,0 +1,103 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "taskindex.h"
+#include "utils.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Smallest table size */
+#define TASKINDEX_MIN 64
+
+/* Fibonacci hashing of the combined identifier */
+static inline size_t taskindex_hash(const struct taskindex *ix,
+                                    taskident taskid) {
+  uint64_t key = ((uint64_t)(uint32_t)taskid.pid << 32) | (uint32_t)taskid.tid;
+  return (size_t)((key * UINT64_C(0x9E3779B97F4A7C15)) >> ix->shift);
+}
+
+static void taskindex_alloc(struct taskindex *ix, size_t size) {
+  size_t n;
+  unsigned bits = 0;
+
+  while(((size_t)1 << bits) < size)
+    ++bits;
+  ix->slots = xrecalloc(NULL, (size_t)1 << bits, sizeof *ix->slots);
+  ix->mask = ((size_t)1 << bits) - 1;
+  ix->shift = 64 - bits;
+  ix->count = 0;
+  for(n = 0; n <= ix->mask; ++n)
+    ix->slots[n].index = SIZE_MAX;
+}
+
+void taskindex_init(struct taskindex *ix, size_t n) {
+  if(n > SIZE_MAX / 4 / sizeof *ix->slots)
+    fatal(0, "too many tasks");
+  taskindex_alloc(ix, max(2 * n, TASKINDEX_MIN));
+}
+
+static void taskindex_grow(struct taskindex *ix) {
+  struct taskindex_slot *old = ix->slots;
+  size_t n, oldsize = ix->mask + 1;
+
+  if(oldsize > SIZE_MAX / 2 / sizeof *ix->slots)
+    fatal(0, "too many tasks");
+  taskindex_alloc(ix, 2 * oldsize);
+  for(n = 0; n < oldsize; ++n)
+    if(old[n].index != SIZE_MAX)
+      taskindex_insert(ix, old[n].taskid, old[n].index);
+  free(old);
+}
+
+void taskindex_insert(struct taskindex *ix, taskident taskid, size_t index) {
+  size_t h;
+
+  if(2 * (ix->count + 1) > ix->mask + 1)
+    taskindex_grow(ix);
+  h = taskindex_hash(ix, taskid);
+  while(ix->slots[h].index != SIZE_MAX) {
+    if(ix->slots[h].taskid.pid == taskid.pid
+       && ix->slots[h].taskid.tid == taskid.tid) {
+      ix->slots[h].index = index;
+      return;
+    }
+    h = (h + 1) & ix->mask;
+  }
+  ix->slots[h].taskid = taskid;
+  ix->slots[h].index = index;
+  ++ix->count;
+}
+
+size_t taskindex_find(const struct taskindex *ix, taskident taskid) {
+  size_t h = taskindex_hash(ix, taskid);
+
+  while(ix->slots[h].index != SIZE_MAX) {
+    if(ix->slots[h].taskid.pid == taskid.pid
+       && ix->slots[h].taskid.tid == taskid.tid)
+      return ix->slots[h].index;
+    h = (h + 1) & ix->mask;
+  }
+  return SIZE_MAX;
+}
+
+void taskindex_free(struct taskindex *ix) {
+  free(ix->slots);
+  ix->slots = NULL;
+}
@@ -0,0 +1,87 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#ifndef TASKINDEX_H
+#define TASKINDEX_H
+
+/** @file taskindex.h
+ * @brief Hash index from task identifiers to array positions
+ */
+
+#include "tasks.h"
+#include <stddef.h>
+
+/** @brief One slot in a task index */
+struct taskindex_slot {
+  /** @brief Task identifier */
+  taskident taskid;
+
+  /** @brief Position of task, or @c SIZE_MAX if the slot is empty */
+  size_t index;
+};
+
+/** @brief Task index
+ *
+ * An open-addressing hash table with linear probing.  The table size
+ * is a power of two and is kept at least twice the number of
+ * entries, so probe sequences stay short however many tasks there
+ * are.
+ */
+struct taskindex {
+  /** @brief Hash table */
+  struct taskindex_slot *slots;
+
+  /** @brief Table size minus 1 */
+  size_t mask;
+
+  /** @brief Shift to reduce a 64-bit hash to a slot number */
+  unsigned shift;
+
+  /** @brief Number of entries */
+  size_t count;
+};
+
+/** @brief Initialize a task index
+ * @param ix Index to initialize
+ * @param n Expected number of entries
+ */
+void taskindex_init(struct taskindex *ix, size_t n);
+
+/** @brief Add an entry to a task index
+ * @param ix Index
+ * @param taskid Task identifier
+ * @param index Position of task
+ *
+ * If @p taskid is already present then its position is replaced.
+ */
+void taskindex_insert(struct taskindex *ix, taskident taskid, size_t index);
+
+/** @brief Find an entry in a task index
+ * @param ix Index
+ * @param taskid Task identifier
+ * @return Position of task, or @c SIZE_MAX if not found
+ */
+size_t taskindex_find(const struct taskindex *ix, taskident taskid);
+
+/** @brief Free a task index
+ * @param ix Index
+ */
+void taskindex_free(struct taskindex *ix);
+
+#endif /* TASKINDEX_H */
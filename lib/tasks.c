@@ -24,7 +24,13 @@
 #include "priv.h"
 #include "general.h"
 #include "io.h"
+#include "parallel.h"
+#include "events.h"
+#include "taskindex.h"
+#include "arena.h"
+#include "statparse.h"
 #include <errno.h>
+#include <fcntl.h>
 #include <string.h>
 #include <stdlib.h>
 #include <time.h>
@@ -33,58 +39,53 @@
 #include <stddef.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
 #include <signal.h>
 #include <time.h>
-
-#if HAVE_GETC_UNLOCKED
-# define GETC getc_unlocked
-#else
-# define GETC getc
-#endif
-
-/* Know /proc/$PID/stat fields (after the first three); S for signed
- * and U for unsigned. */
-#define STAT_PROPS(U,S) S(ppid)                 \
-  S(pgrp)                                       \
-  S(session)                                    \
-  S(tty_nr)                                     \
-  S(tpgid)                                      \
+#include <pthread.h>
+
+/* Know /proc/$PID/stat fields (after the first three).  I fields are
+ * kept as int, U fields as uintmax_t, and X fields are not kept at
+ * all since nothing uses them. */
+#define STAT_PROPS(I,U,X) I(ppid)               \
+  I(pgrp)                                       \
+  I(session)                                    \
+  I(tty_nr)                                     \
+  I(tpgid)                                      \
   U(flags)                                      \
   U(minflt)                                     \
-  U(cminflt)                                    \
+  X(cminflt)                                    \
   U(majflt)                                     \
-  U(cmajflt)                                    \
+  X(cmajflt)                                    \
   U(utime)                                      \
   U(stime)                                      \
-  S(cutime)                                     \
-  S(cstime)                                     \
-  S(priority)                                   \
-  S(nice)                                       \
-  S(num_threads)                                \
-  S(itrealvalue)                                \
+  X(cutime)                                     \
+  X(cstime)                                     \
+  I(priority)                                   \
+  I(nice)                                       \
+  I(num_threads)                                \
+  X(itrealvalue)                                \
   U(starttime)                                  \
   U(vsize)                                      \
   U(rss)                                        \
-  U(rsslim)                                     \
-  U(startcode)                                  \
-  U(endcode)                                    \
-  U(startstack)                                 \
-  U(kstkesp)                                    \
+  X(rsslim)                                     \
+  X(startcode)                                  \
+  X(endcode)                                    \
+  X(startstack)                                 \
+  X(kstkesp)                                    \
   U(kstkeip)                                    \
-  U(signal)                                     \
-  U(blocked)                                    \
-  U(sigignore)                                  \
-  U(sigcatch)                                   \
+  X(signal)                                     \
+  X(blocked)                                    \
+  X(sigignore)                                  \
+  X(sigcatch)                                   \
   U(wchan)                                      \
-  U(nswap)                                      \
-  U(cnswap)                                     \
-  S(exit_signal)                                \
-  S(processor)                                  \
-  U(rt_priority)                                \
-  U(policy)                                     \
-  U(delayacct_blkio_ticks)                      \
-  U(guest_time)                                 \
-  S(cguest_time)
+  X(nswap)                                      \
+  X(cnswap)                                     \
+  X(exit_signal)                                \
+  X(processor)                                  \
+  I(rt_priority)                                \
+  I(policy)
 
 #define IO_PROPS(U,S) U(rchar) \
   U(wchar)                     \
@@ -106,26 +107,63 @@
   M(VmLib, 512)                                 \
   M(VmPTE, 1024)                                 \
   M(VmSwap, 2048)
+/* Files whose FDs are kept open between snapshots */
+enum {
+  TF_STAT,
+  TF_STATUS,
+  TF_IO,
+  NTASKFILES
+};
+
 #define VMMEMBER(N,B) uintmax_t prop_##N;
-#define VMTABLE(N,B) { #N, offsetof(struct task, prop_##N), B },
 #define VMENUM(N,B) bit_##N = B,
 enum {
   VM_PROPS(VMENUM)
 };
 
-#define SMEMBER(X) intmax_t prop_##X;
-#define BASE_SMEMBER(X) uintmax_t base_##X;
+#define IMEMBER(X) int prop_##X;
 #define UMEMBER(X) uintmax_t prop_##X;
+#define XMEMBER(X)
 #define BASE_UMEMBER(X) uintmax_t base_##X;
-#define OFFSET(X) offsetof(struct task, prop_##X),
-#define UPDATE_BASE(X) t->base_##X = lastt->prop_##X;
+#define STAT_INT(X) { offsetof(struct task, prop_##X), sizeof (int) },
+#define STAT_UINTMAX(X) { offsetof(struct task, prop_##X), sizeof (uintmax_t) },
+#define STAT_SKIP(X) { 0, 0 },
+#define IO_OFFSET(X) offsetof(struct io_info, prop_##X),
+#define UPDATE_BASE(X) io->base_##X = lastt->io_info->prop_##X;
+
+/* Signal sets as reported in status.  No Linux platform has more than
+ * 128 signals. */
+#define SIGWORDS 2
+typedef uint64_t sigbits[SIGWORDS];
+
+/* Information from /proc/PID/status.  This is allocated only when
+ * the file is read. */
+struct status_info {
+  uid_t prop_ruid, prop_euid, prop_suid, prop_fsuid;
+  gid_t prop_rgid, prop_egid, prop_sgid, prop_fsgid;
+  unsigned keys;                /* status_keys slots parsed */
+  unsigned vmbits;              /* Vm... bit set */
+  size_t ngroups;
+  gid_t *groups;
+  sigbits sigpending, sigblocked, sigignored, sigcaught;
+  VM_PROPS(VMMEMBER)
+};
 
+/* Information from /proc/PID/io, and the previous sample of it.  This
+ * is allocated only when the file is read, or if it was read for
+ * the previous sample. */
+struct io_info {
+  struct timespec base_io_time, io_time;
+  IO_PROPS(UMEMBER,UMEMBER)
+  IO_PROPS(BASE_UMEMBER,BASE_UMEMBER)
+};
+
+/* Everything else is kept in the task array, which is searched and
+ * sorted, so it should be kept small. */
 struct task {
   taskident taskid;      /* process/thread ID */
-  size_t link;                  /* hash table linkage */
   unsigned selected:1;          /* nonzero if selected */
   unsigned stat:1;              /* nonzero if task_stat() called */
-  unsigned status:1;            /* nonzero if task_status() called */
   unsigned io:1;                /* nonzero if task_io() called */
   unsigned smaps:1;             /* nonzero if task_smaps() called */
   unsigned sorted:1;            /* nonzero if properties sorted */
@@ -133,66 +171,156 @@ struct task {
   unsigned elapsed_set:1;       /* nonzero if elapsed has been set */
   unsigned oom_score_set:1;     /* nonzero if oom_score is set */
   unsigned pss:1;               /* nonzero if prop_pss valid */
-  unsigned vmbits;              /* Vm... bit set */
+  unsigned fds_inherited:1;     /* nonzero if fds not yet validated */
+  unsigned prefetch:1;          /* nonzero if task_prefetch() wants it */
+  unsigned cmdline_inherited:1; /* nonzero if prop_cmdline not yet validated */
+  unsigned cmdline_age:4;       /* snapshots prop_cmdline has been reused for */
+  int prop_state;
   char *prop_comm;
   char *prop_cmdline;
-  int prop_state;
+  struct status_info *status_info;
+  struct io_info *io_info;
   intmax_t elapsed;
-  uid_t prop_ruid, prop_euid, prop_suid, prop_fsuid;
-  gid_t prop_rgid, prop_egid, prop_sgid, prop_fsgid;
-  intmax_t base_utime, base_stime;
+  uintmax_t base_utime, base_stime;
   uintmax_t base_majflt, base_minflt;
   struct timespec base_stat_time, stat_time;
-  struct timespec base_io_time, io_time;
   intmax_t oom_score;
   uintmax_t prop_pss, prop_swap;
-  size_t ngroups;
-  gid_t *groups;
-  sigset_t sigpending, sigblocked, sigignored, sigcaught;
-  STAT_PROPS(UMEMBER,SMEMBER)
-  IO_PROPS(UMEMBER,SMEMBER)
-  IO_PROPS(BASE_SMEMBER,BASE_UMEMBER)
-  VM_PROPS(VMMEMBER)
+  int fds[NTASKFILES];          /* cached FDs or -1 */
+  size_t lru_prev, lru_next;    /* FD cache linkage */
+  uintmax_t base_starttime;     /* starttime in previous snapshot */
+  char *base_comm;              /* comm in previous snapshot */
+  STAT_PROPS(IMEMBER,UMEMBER,XMEMBER)
 };
 
-static const size_t propinfo_stat[] = {
-  STAT_PROPS(OFFSET,OFFSET)
+static const struct stat_field propinfo_stat[] = {
+  STAT_PROPS(STAT_INT,STAT_UINTMAX,STAT_SKIP)
 };
 #define NSTATS (sizeof propinfo_stat / sizeof *propinfo_stat)
 
 static const size_t propinfo_io[] = {
-  IO_PROPS(OFFSET,OFFSET)
+  IO_PROPS(IO_OFFSET,IO_OFFSET)
 };
 #define NIOS (sizeof propinfo_io / sizeof *propinfo_io)
 
-static const struct {
+/* Keys of /proc/PID/status that are used, indexed by a perfect hash
+ * of the key's first, third and fourth characters and its length.
+ * For keys of length 3, the fourth character is the ':'.  A collision
+ * between two keys is reported by -Woverride-init. */
+#define STATUS_HASH(C0,C2,C3,LEN) (((C0) + 2 * (C2) + (C3) + (LEN)) & 31)
+#define NSTATUS_SLOTS 32
+#define STATUS_KEYMIN 3
+#define STATUS_KEYMAX 6
+
+enum {
+  STATUS_VM,
+  STATUS_UIDS,
+  STATUS_GIDS,
+  STATUS_GROUPS,
+  STATUS_SIG,
+};
+
+#define VMKEY(N,C0,C2,C3,SOURCE)                                \
+  [STATUS_HASH(C0,C2,C3,sizeof #N - 1)] = {                     \
+    #N, sizeof #N - 1, STATUS_VM, SOURCE,                       \
+    offsetof(struct status_info, prop_##N), bit_##N             \
+  },
+#define SIGKEY(N,C0,C2,C3,MEMBER)                               \
+  [STATUS_HASH(C0,C2,C3,sizeof #N - 1)] = {                     \
+    #N, sizeof #N - 1, STATUS_SIG, TASK_SRC_STATUS_SIGNALS,     \
+    offsetof(struct status_info, MEMBER), 0                     \
+  },
+
+static const struct status_key {
   const char *name;
-  size_t offset;
-  unsigned bit;
-} propinfo_vm[] = {
-  VM_PROPS(VMTABLE)
+  size_t len;
+  int type;
+  unsigned sources;             /* TASK_SRC_STATUS_... wanting this */
+  size_t offset;                /* for STATUS_VM and STATUS_SIG */
+  unsigned bit;                 /* for STATUS_VM */
+} status_keys[NSTATUS_SLOTS] = {
+  VMKEY(VmPeak, 'V', 'P', 'e', TASK_SRC_STATUS_VM)
+  /* vsize and rss use VmSize and VmRSS if they were read, else stat */
+  VMKEY(VmSize, 'V', 'S', 'i', TASK_SRC_STATUS_VM)
+  VMKEY(VmLck, 'V', 'L', 'c', TASK_SRC_STATUS_VM)
+  VMKEY(VmPin, 'V', 'P', 'i', TASK_SRC_STATUS_VM)
+  VMKEY(VmHWM, 'V', 'H', 'W', TASK_SRC_STATUS_VM)
+  VMKEY(VmRSS, 'V', 'R', 'S', TASK_SRC_STATUS_VM)
+  VMKEY(VmData, 'V', 'D', 'a', TASK_SRC_STATUS_VM)
+  VMKEY(VmStk, 'V', 'S', 't', TASK_SRC_STATUS_VM)
+  VMKEY(VmExe, 'V', 'E', 'x', TASK_SRC_STATUS_VM)
+  VMKEY(VmLib, 'V', 'L', 'i', TASK_SRC_STATUS_VM)
+  VMKEY(VmPTE, 'V', 'P', 'T', TASK_SRC_STATUS_VM)
+  VMKEY(VmSwap, 'V', 'S', 'w', TASK_SRC_STATUS_VM)
+  [STATUS_HASH('U', 'd', ':', 3)] = {
+    "Uid", 3, STATUS_UIDS, TASK_SRC_STATUS_IDS, 0, 0
+  },
+  [STATUS_HASH('G', 'd', ':', 3)] = {
+    "Gid", 3, STATUS_GIDS, TASK_SRC_STATUS_IDS, 0, 0
+  },
+  [STATUS_HASH('G', 'o', 'u', 6)] = {
+    "Groups", 6, STATUS_GROUPS, TASK_SRC_STATUS_GROUPS, 0, 0
+  },
+  SIGKEY(SigPnd, 'S', 'g', 'P', sigpending)
+  SIGKEY(SigBlk, 'S', 'g', 'B', sigblocked)
+  SIGKEY(SigIgn, 'S', 'g', 'I', sigignored)
+  SIGKEY(SigCgt, 'S', 'g', 'C', sigcaught)
 };
-#define NVMS (sizeof propinfo_vm / sizeof *propinfo_vm)
 
-#define HASH_SIZE 256           /* hash table size */
+/* Loader for files in a task's /proc directory */
+struct reader {
+  taskident taskid;             /* task whose directory is open */
+  int dirfd;                    /* directory FD or -1 */
+  char *buffer;                 /* file contents */
+  size_t bufsize;               /* size of buffer */
+  int shared;                   /* nonzero if other readers are active */
+  struct arena *arena;          /* where task data is allocated */
+};
 
 struct taskinfo {
   /* How many processes/threads are in the system */
   size_t nprocesses, nthreads;
   /* Number of entries, and space, in tasks array */
   size_t ntasks, nslots;
-  /* Table of processes and threads */
+  /* Table of processes and threads.  Each process is immediately
+   * followed by its threads. */
   struct task *tasks;
   /* Real time that this sample was started */
   struct timespec time;
-  /* Heads of hash chains */
-  size_t lookup[HASH_SIZE];
+  /* Index of tasks array */
+  struct taskindex index;
+  /* FD for /proc, and the path it was opened with */
+  int procfd;
+  const char *procpath;
+  /* Most and least recently used tasks with cached FDs */
+  size_t lru_head, lru_tail;
+  /* Loader used outside parallel sections */
+  struct reader reader;
+  /* Strings and side tables belonging to tasks */
+  struct arena arena;
+  /* Process tree, indexed like tasks; built on demand by task_tree().
+   * A process's descendants have positions from tree_rank + 1 up to
+   * (but excluding) tree_end.  tree_root is the index of the top of
+   * the process's tree.  tree_parent is the index of the parent
+   * process, or SIZE_MAX for a root, and tree_order lists the
+   * tree_nodes processes by position. */
+  size_t *tree_rank, *tree_end, *tree_root, *tree_parent, *tree_order;
+  size_t tree_nodes;
+  int *tree_depth;
+  /* Subtree totals, indexed like tasks; see task_tree_total() */
+  double *tree_pcpu, *tree_io, *tree_rss, *tree_pss;
 };
 
 static struct task *task_find(const struct taskinfo *ti, taskident taskid);
+static void reader_close(struct reader *r);
+static void task_uncache(struct taskinfo *ti, struct task *t);
+static void task_inherit_fds(struct taskinfo *ti, struct taskinfo *last);
+static void task_prefetch_marked(struct taskinfo *ti, unsigned sources);
 
 const char *proc = "/proc";
 pid_t selfpid = -1;
+unsigned task_workers;
+int task_smaps_rollup = 1;
 
 // ----------------------------------------------------------------------------
 
@@ -205,12 +333,14 @@ static uintmax_t conv(const char *s) {
 void task_free(struct taskinfo *ti) {
   if(ti) {
     size_t n;
-    for(n = 0; n < ti->ntasks; ++n) {
-      free(ti->tasks[n].prop_comm);
-      free(ti->tasks[n].prop_cmdline);
-      free(ti->tasks[n].groups);
-    }
+    for(n = 0; n < ti->ntasks; ++n)
+      task_uncache(ti, &ti->tasks[n]);
     free(ti->tasks);
+    arena_free(&ti->arena);
+    taskindex_free(&ti->index);
+    reader_close(&ti->reader);
+    if(ti->procfd >= 0)
+      close(ti->procfd);
     free(ti);
   }
 }
@@ -219,15 +349,41 @@ void task_free(struct taskinfo *ti) {
  * The process and all its threads (if they have been enumerated)
  * are all marked as vanished. */
 static void task_vanished(struct taskinfo *ti, pid_t pid) {
+  taskident taskid = { pid, -1 };
   size_t n;
-  for(n = 0; n < ti->ntasks; ++n)
-    if(ti->tasks[n].taskid.pid == pid)
-      ti->tasks[n].vanished = 1;
+  /* The process's threads immediately follow it */
+  for(n = taskindex_find(&ti->index, taskid);
+      n < ti->ntasks && ti->tasks[n].taskid.pid == pid;
+      ++n)
+    ti->tasks[n].vanished = 1;
+}
+
+/* Number of snapshots a command line is reused for before it is read
+ * again.  This bounds how long changes made with setproctitle() and
+ * the like can go unnoticed. */
+#define CMDLINE_REUSE 10
+
+/* Carry over LASTT's name and command line to T.  They are copied,
+ * because the previous snapshot may be freed first.  They are only
+ * used once T's stat has confirmed that it is the same process. */
+static void task_inherit_names(struct taskinfo *ti, struct task *t,
+                               const struct task *lastt) {
+  t->base_starttime = lastt->prop_starttime;
+  if(lastt->prop_comm)
+    t->base_comm = arena_strdup(&ti->arena, lastt->prop_comm);
+  if(lastt->prop_cmdline && !lastt->cmdline_inherited
+     && lastt->cmdline_age < CMDLINE_REUSE) {
+    t->prop_cmdline = arena_strdup(&ti->arena, lastt->prop_cmdline);
+    t->cmdline_inherited = 1;
+    t->cmdline_age = lastt->cmdline_age + 1;
+  }
 }
 
 static struct task *task_add(struct taskinfo *ti, struct taskinfo *last,
                                 pid_t pid, pid_t tid) {
   struct task *t, *lastt;
+  struct io_info *io;
+  size_t n;
   /* Make sure the array is big enough */
   if(ti->ntasks >= ti->nslots) {
     if((ssize_t)(ti->nslots = ti->nslots ? 2 * ti->nslots : 64) <= 0)
@@ -245,71 +401,409 @@ static struct task *task_add(struct taskinfo *ti, struct taskinfo *last,
     t->base_stat_time = lastt->stat_time;
     t->base_majflt = lastt->prop_majflt;
     t->base_minflt = lastt->prop_minflt;
-    IO_PROPS(UPDATE_BASE, UPDATE_BASE);
-    t->base_io_time = lastt->io_time;
+    if(lastt->stat && !lastt->vanished && ti->procpath == last->procpath)
+      task_inherit_names(ti, t, lastt);
+    if(lastt->io_info) {
+      t->io_info = io = arena_calloc(&ti->arena, 1, sizeof *io);
+      IO_PROPS(UPDATE_BASE, UPDATE_BASE);
+      io->base_io_time = lastt->io_info->io_time;
+    }
   }
-  t->link = SIZE_MAX;
+  for(n = 0; n < NTASKFILES; ++n)
+    t->fds[n] = -1;
+  t->lru_prev = t->lru_next = SIZE_MAX;
   return t;
 }
 
-static void task_enumerate_threads(struct taskinfo *ti, struct taskinfo *last,
-                                   pid_t pid) {
-  DIR *dp;
-  struct dirent *de;
-  char *path;
-  pid_t tid;
+/* Size of buffer for getdents64() */
+#define DIRENT_BUFSIZE 131072
 
-  if(!(dp = opendirf(&path, "%s/%ld/task", proc, (long)pid))) {
-    task_vanished(ti, pid);
-    free(path);
+struct linux_dirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+static void append_id(pid_t **idsp, size_t *nidsp, size_t *nslotsp,
+                      pid_t id) {
+  if(*nidsp >= *nslotsp) {
+    if((ssize_t)(*nslotsp = *nslotsp ? 2 * *nslotsp : 64) <= 0)
+      fatal(0, "too many tasks");
+    *idsp = xrecalloc(*idsp, *nslotsp, sizeof **idsp);
+  }
+  (*idsp)[(*nidsp)++] = id;
+}
+
+/* Read the numeric entries of directory DIRFD, appending them to
+ * *IDSP (which has *NIDSP entries and space for *NSLOTSP).  BUF is
+ * DIRENT_BUFSIZE bytes of scratch space.  Returns 0 on success and
+ * -1 on error. */
+static int read_ids(int dirfd, char *buf,
+                    pid_t **idsp, size_t *nidsp, size_t *nslotsp) {
+  long n, pos;
+  struct linux_dirent64 *de;
+
+  while((n = syscall(SYS_getdents64, dirfd, buf, DIRENT_BUFSIZE)) > 0) {
+    for(pos = 0; pos < n; pos += de->d_reclen) {
+      de = (struct linux_dirent64 *)(buf + pos);
+      /* Only consider files that look like tasks */
+      if(!de->d_name[0]
+         || strspn(de->d_name, "0123456789") != strlen(de->d_name))
+        continue;
+      append_id(idsp, nidsp, nslotsp, conv(de->d_name));
+    }
+  }
+  return n < 0 ? -1 : 0;
+}
+
+/* Per-worker state for thread enumeration */
+struct thread_scan_worker {
+  pid_t *tids;                  /* thread IDs found by this worker */
+  size_t ntids, nslots;
+  char *buf;                    /* getdents64() buffer */
+};
+
+/* Per-process result of thread enumeration */
+struct thread_scan_result {
+  unsigned worker;              /* which worker found the threads */
+  size_t start, count;          /* range within that worker's tids */
+};
+
+struct thread_scan {
+  int procfd;
+  struct task *procs;
+  struct thread_scan_worker *workers;
+  struct thread_scan_result *results;
+};
+
+static void task_enumerate_threads(void *u, size_t i, unsigned worker) {
+  struct thread_scan *ts = u;
+  struct thread_scan_worker *w = &ts->workers[worker];
+  struct thread_scan_result *r = &ts->results[i];
+  struct task *t = &ts->procs[i];
+  char path[64];
+  struct stat sb;
+  int fd;
+
+  r->worker = worker;
+  r->start = w->ntids;
+  snprintf(path, sizeof path, "%ld/task", (long)t->taskid.pid);
+  /* The link count of /proc/PID/task is 2 plus the number of
+   * threads.  Most processes have just one thread, whose ID is the
+   * same as the process ID, so there's no need to read the
+   * directory. */
+  if(fstatat(ts->procfd, path, &sb, 0) == 0 && sb.st_nlink == 3) {
+    append_id(&w->tids, &w->ntids, &w->nslots, t->taskid.pid);
+    r->count = 1;
     return;
   }
-  while((de = xreaddir(path, dp))) {
-    /* Only consider files that look like threads */
-    if(strspn(de->d_name, "0123456789") == strlen(de->d_name)) {
-      tid = conv(de->d_name);
-      task_add(ti, last, pid, tid);
-      ++ti->nthreads;
+  if((fd = openat(ts->procfd, path,
+                  O_RDONLY|O_DIRECTORY|O_CLOEXEC)) < 0) {
+    /* Only this process has been recorded so far so there's no need
+     * to search for threads to mark */
+    t->vanished = 1;
+    return;
+  }
+  if(!w->buf)
+    w->buf = xmalloc(DIRENT_BUFSIZE);
+  if(read_ids(fd, w->buf, &w->tids, &w->ntids, &w->nslots) < 0) {
+    t->vanished = 1;
+    w->ntids = r->start;
+  }
+  close(fd);
+  r->count = w->ntids - r->start;
+}
+
+/* Enumerate tasks by scanning /proc */
+static void task_scan(struct taskinfo *ti, struct taskinfo *last,
+                      unsigned flags) {
+  size_t n, i, nprocs, npids = 0, npidslots = 0, ntids;
+  pid_t *pids = NULL, *tids;
+  struct task *procs;
+  struct thread_scan ts;
+  struct select_candidates c;
+  unsigned workers;
+  char *buf;
+
+  memset(&c, 0, sizeof c);
+  c.procfd = ti->procfd;
+  c.threads = !!(flags & TASK_THREADS);
+  if((flags & TASK_SELECTED) && select_candidates(&c)) {
+    pids = c.pids;
+    npids = c.npids;
+  } else {
+    if(last) {
+      /* Expect about as many processes as last time */
+      npidslots = last->nprocesses + last->nprocesses / 8 + 64;
+      pids = xrecalloc(NULL, npidslots, sizeof *pids);
+    }
+    buf = xmalloc(DIRENT_BUFSIZE);
+    if(read_ids(ti->procfd, buf, &pids, &npids, &npidslots) < 0)
+      fatal(errno, "reading %s", proc);
+    free(buf);
+  }
+  ti->nslots = npids;
+  ti->tasks = xrecalloc(NULL, ti->nslots, sizeof *ti->tasks);
+  for(n = 0; n < npids; ++n) {
+    task_add(ti, last, pids[n], -1);
+    ++ti->nprocesses;
+  }
+  free(pids);
+  if(flags & TASK_THREADS) {
+    /* Find the threads of each process, possibly in parallel.  The
+     * threads of each process immediately follow it in the final
+     * array, just as if everything had been done serially. */
+    nprocs = ti->ntasks;
+    workers = parallel_workers(task_workers, nprocs);
+    ts.procfd = ti->procfd;
+    ts.procs = procs = ti->tasks;
+    ts.workers = xrecalloc(NULL, workers, sizeof *ts.workers);
+    memset(ts.workers, 0, workers * sizeof *ts.workers);
+    ts.results = xrecalloc(NULL, nprocs, sizeof *ts.results);
+    memset(ts.results, 0, nprocs * sizeof *ts.results);
+    parallel_run(nprocs, workers, task_enumerate_threads, &ts);
+    ntids = 0;
+    for(n = 0; n < workers; ++n)
+      ntids += ts.workers[n].ntids;
+    ti->ntasks = 0;
+    ti->nslots = nprocs + ntids;
+    ti->tasks = xrecalloc(NULL, ti->nslots, sizeof *ti->tasks);
+    for(n = 0; n < nprocs; ++n) {
+      ti->tasks[ti->ntasks++] = procs[n];
+      tids = ts.workers[ts.results[n].worker].tids + ts.results[n].start;
+      for(i = 0; i < ts.results[n].count; ++i) {
+        task_add(ti, last, procs[n].taskid.pid, tids[i]);
+        ++ti->nthreads;
+      }
     }
+    for(n = 0; n < workers; ++n) {
+      free(ts.workers[n].tids);
+      free(ts.workers[n].buf);
+    }
+    free(ts.workers);
+    free(ts.results);
+    free(procs);
+  }
+}
+
+// ----------------------------------------------------------------------------
+
+/* With TASK_EVENTS, the set of tasks is maintained from process
+ * events rather than by scanning /proc each time.  Forks add tasks
+ * straight away.  Exits only queue the task to be checked, since
+ * the task stays visible in /proc until it is reaped.  Anything that
+ * can't be tracked reliably (lost events, or an exec from a
+ * non-leader thread, which changes thread IDs) forces a rescan. */
+
+static struct {
+  int fd;                       /* events FD, or -1 */
+  int failed;                   /* nonzero if events unavailable */
+  int valid;                    /* nonzero if live is up to date */
+  taskident *live;              /* all tasks, in enumeration order */
+  size_t nlive, nliveslots;
+  taskident *added;             /* newly created tasks */
+  size_t nadded, naddedslots;
+  taskident *check;             /* tasks that might have gone */
+  size_t ncheck, ncheckslots;
+} events = { -1, 0, 0, NULL, 0, 0, NULL, 0, 0, NULL, 0, 0 };
+
+static void taskident_append(taskident **ids, size_t *nids, size_t *nslots,
+                             pid_t pid, pid_t tid) {
+  if(*nids >= *nslots) {
+    if((ssize_t)(*nslots = *nslots ? 2 * *nslots : 64) <= 0)
+      fatal(0, "too many tasks");
+    *ids = xrecalloc(*ids, *nslots, sizeof **ids);
+  }
+  (*ids)[*nids].pid = pid;
+  (*ids)[(*nids)++].tid = tid;
+}
+
+/* Processes sort before their threads, matching a scan of /proc */
+static int taskident_compare(const void *av, const void *bv) {
+  const taskident *a = av, *b = bv;
+  if(a->pid != b->pid)
+    return a->pid < b->pid ? -1 : 1;
+  if(a->tid != b->tid)
+    return a->tid < b->tid ? -1 : 1;
+  return 0;
+}
+
+static void task_event(void attribute((unused)) *u,
+                       int what, pid_t pid, pid_t tid) {
+  switch(what) {
+  case EVENT_FORK:
+    if(pid == tid)
+      taskident_append(&events.added, &events.nadded, &events.naddedslots,
+                       pid, -1);
+    taskident_append(&events.added, &events.nadded, &events.naddedslots,
+                     pid, tid);
+    break;
+  case EVENT_EXEC:
+    if(pid != tid)
+      events.valid = 0;
+    break;
+  case EVENT_EXIT:
+    taskident_append(&events.check, &events.ncheck, &events.ncheckslots,
+                     pid, tid);
+    break;
   }
-  closedir(dp);
-  free(path);
 }
 
+/* Bring the live set up to date.  Returns nonzero on success, 0 if a
+ * full scan is required. */
+static int task_events_update(int procfd) {
+  size_t n, i, j, k, nkeep;
+  taskident *merged, *gone, leader;
+  char path[64];
+
+  if(events.failed)
+    return 0;
+  if(events.fd < 0) {
+    /* Events describe the real system, not a copy of /proc */
+    if(strcmp(proc, "/proc") || (events.fd = events_open()) < 0) {
+      events.failed = 1;
+      return 0;
+    }
+  }
+  if(events_read(events.fd, task_event, NULL) < 0)
+    events.valid = 0;
+  if(!events.valid) {
+    events.nadded = events.ncheck = 0;
+    return 0;
+  }
+  /* Merge in new tasks */
+  if(events.nadded) {
+    qsort(events.added, events.nadded, sizeof *events.added,
+          taskident_compare);
+    merged = xrecalloc(NULL, events.nlive + events.nadded, sizeof *merged);
+    for(i = j = k = 0; i < events.nlive || j < events.nadded;) {
+      int c = (i == events.nlive ? 1
+               : j == events.nadded ? -1
+               : taskident_compare(&events.live[i], &events.added[j]));
+      if(c <= 0)
+        merged[k] = events.live[i++];
+      else
+        merged[k] = events.added[j];
+      if(c >= 0)
+        ++j;
+      /* PID reuse can mean we are told about a task twice */
+      if(!k || taskident_compare(&merged[k - 1], &merged[k]))
+        ++k;
+    }
+    free(events.live);
+    events.live = merged;
+    events.nlive = events.nliveslots = k;
+    events.nadded = 0;
+  }
+  /* Find which possibly-exited tasks have really gone */
+  if(events.ncheck) {
+    gone = xrecalloc(NULL, events.ncheck, sizeof *gone);
+    for(n = nkeep = k = 0; n < events.ncheck; ++n) {
+      if(events.check[n].pid == events.check[n].tid)
+        snprintf(path, sizeof path, "%ld", (long)events.check[n].pid);
+      else
+        snprintf(path, sizeof path, "%ld/task/%ld",
+                 (long)events.check[n].pid, (long)events.check[n].tid);
+      if(faccessat(procfd, path, F_OK, 0) < 0 && errno == ENOENT)
+        gone[k++] = events.check[n];
+      else
+        events.check[nkeep++] = events.check[n];
+    }
+    events.ncheck = nkeep;
+    qsort(gone, k, sizeof *gone, taskident_compare);
+    for(i = n = 0; i < events.nlive; ++i) {
+      /* A departed leader takes the whole process with it */
+      leader.pid = leader.tid = events.live[i].pid;
+      if(bsearch(&leader, gone, k, sizeof *gone, taskident_compare)
+         || bsearch(&events.live[i], gone, k, sizeof *gone,
+                    taskident_compare))
+        continue;
+      events.live[n++] = events.live[i];
+    }
+    events.nlive = n;
+    free(gone);
+  }
+  return 1;
+}
+
+/* Enumerate tasks from the live set */
+static void task_replay(struct taskinfo *ti, struct taskinfo *last,
+                        unsigned flags) {
+  size_t n;
+
+  ti->nslots = events.nlive;
+  ti->tasks = xrecalloc(NULL, ti->nslots, sizeof *ti->tasks);
+  for(n = 0; n < events.nlive; ++n) {
+    if(events.live[n].tid == -1)
+      ++ti->nprocesses;
+    else if(flags & TASK_THREADS)
+      ++ti->nthreads;
+    else
+      continue;
+    task_add(ti, last, events.live[n].pid, events.live[n].tid);
+  }
+}
+
+/* Rebuild the live set from a full scan */
+static void task_events_reset(struct taskinfo *ti, unsigned flags) {
+  size_t n, k;
+
+  events.nlive = 0;
+  for(n = 0; n < ti->ntasks; ++n)
+    taskident_append(&events.live, &events.nlive, &events.nliveslots,
+                     ti->tasks[n].taskid.pid, ti->tasks[n].taskid.tid);
+  qsort(events.live, events.nlive, sizeof *events.live, taskident_compare);
+  events.valid = 1;
+  if(!(flags & TASK_THREADS)) {
+    /* Threads were only scanned for the live set's benefit */
+    for(n = k = 0; n < ti->ntasks; ++n)
+      if(ti->tasks[n].taskid.tid == -1)
+        ti->tasks[k++] = ti->tasks[n];
+    ti->ntasks = k;
+    ti->nthreads = 0;
+  }
+}
+
+int task_events(void) {
+  return events.fd >= 0;
+}
+
+// ----------------------------------------------------------------------------
+
 struct taskinfo *task_enumerate(struct taskinfo *last,
                                 unsigned flags) {
-  DIR *dp;
-  struct dirent *de;
   size_t n;
   struct taskinfo *ti;
-  pid_t pid;
 
   ti = xmalloc(sizeof *ti);
   memset(ti, 0, sizeof *ti);
   if(clock_gettime(CLOCK_REALTIME, &ti->time) < 0)
     fatal(errno, "clock_gettime");
-  /* Look through /proc for process information */
-  if(!(dp = opendir(proc)))
+  if((ti->procfd = open(proc, O_RDONLY|O_DIRECTORY|O_CLOEXEC)) < 0)
     fatal(errno, "opening %s", proc);
-  while((de = xreaddir(proc, dp))) {
-    /* Only consider files that look like processes */
-    if(strspn(de->d_name, "0123456789") == strlen(de->d_name)) {
-      pid = conv(de->d_name);
-      task_add(ti, last, pid, -1);
-      ++ti->nprocesses;
-      if(flags & TASK_THREADS)
-        task_enumerate_threads(ti, last, pid);
-    }
-  }
-  closedir(dp);
-  for(n = 0; n < HASH_SIZE; ++n)
-    ti->lookup[n] = SIZE_MAX;
-  for(n = 0; n < ti->ntasks; ++n) {
-    size_t h = (size_t)(ti->tasks[n].taskid.pid + ti->tasks[n].taskid.tid) % HASH_SIZE;
-    if(ti->lookup[h] != SIZE_MAX)
-      ti->tasks[n].link = ti->lookup[h];
-    ti->lookup[h] = n;
-  }
+  ti->procpath = proc;
+  ti->reader.dirfd = -1;
+  ti->reader.arena = &ti->arena;
+  ti->lru_head = ti->lru_tail = SIZE_MAX;
+  /* Event tracking needs to see everything */
+  if(flags & TASK_EVENTS)
+    flags &= ~TASK_SELECTED;
+  if(!(flags & TASK_EVENTS))
+    task_scan(ti, last, flags);
+  else if(task_events_update(ti->procfd))
+    task_replay(ti, last, flags);
+  else if(events.fd >= 0) {
+    task_scan(ti, last, flags|TASK_THREADS);
+    task_events_reset(ti, flags);
+  } else
+    task_scan(ti, last, flags);
+  taskindex_init(&ti->index, ti->ntasks);
+  for(n = 0; n < ti->ntasks; ++n)
+    taskindex_insert(&ti->index, ti->tasks[n].taskid, n);
+  if(last)
+    task_inherit_fds(ti, last);
   task_reselect(ti);
   return ti;
 }
@@ -327,7 +821,15 @@ void task_time(struct taskinfo *ti, struct timespec *ts) {
 }
 
 void task_reselect(struct taskinfo *ti) {
+  unsigned sources = select_sources();
   size_t n;
+
+  /* Load everything the selectors will need in one go */
+  if(sources) {
+    for(n = 0; n < ti->ntasks; ++n)
+      ti->tasks[n].prefetch = 1;
+    task_prefetch_marked(ti, sources);
+  }
   for(n = 0; n < ti->ntasks; ++n)
     ti->tasks[n].selected = select_test(ti, ti->tasks[n].taskid);
 }
@@ -335,98 +837,352 @@ void task_reselect(struct taskinfo *ti) {
 // ----------------------------------------------------------------------------
 
 static struct task *task_find(const struct taskinfo *ti, taskident taskid) {
-  size_t n = ti->lookup[(size_t)(taskid.pid + taskid.tid) % HASH_SIZE];
-  while(n != SIZE_MAX
-        && (ti->tasks[n].taskid.pid != taskid.pid
-            || ti->tasks[n].taskid.tid != taskid.tid))
-    n = ti->tasks[n].link;
+  size_t n = taskindex_find(&ti->index, taskid);
   return n != SIZE_MAX ? &ti->tasks[n] : NULL;
 }
 
 // ----------------------------------------------------------------------------
 
-static void getpath(const struct task *t,
-                    const char *what,
-                    char buffer[],
-                    size_t bufsize) {
+/* Open the /proc directory for task T, unless it is already open */
+static int reader_open(struct taskinfo *ti, struct reader *r,
+                       const struct task *t) {
+  char path[64];
+
+  if(r->dirfd >= 0) {
+    if(r->taskid.pid == t->taskid.pid && r->taskid.tid == t->taskid.tid)
+      return 0;
+    close(r->dirfd);
+    r->dirfd = -1;
+  }
   if(t->taskid.tid == -1)
-    snprintf(buffer, bufsize, "%s/%ld/%s", proc, (long)t->taskid.pid, what);
+    snprintf(path, sizeof path, "%ld", (long)t->taskid.pid);
   else
-    snprintf(buffer, bufsize, "%s/%ld/task/%ld/%s",
-             proc, (long)t->taskid.pid, (long)t->taskid.tid, what);
+    snprintf(path, sizeof path, "%ld/task/%ld",
+             (long)t->taskid.pid, (long)t->taskid.tid);
+  if((r->dirfd = openat(ti->procfd, path,
+                        O_RDONLY|O_DIRECTORY|O_CLOEXEC)) < 0)
+    return -1;
+  r->taskid = t->taskid;
+  return 0;
 }
 
-static void task_stat(struct taskinfo *ti, struct task *t) {
-  FILE *fp;
-  char buffer[1024], *start, *bp;
-  size_t field;
-  uintmax_t *ptr, value;
+/* Read the whole of FD, from the start, into R's buffer */
+static ssize_t reader_read(struct reader *r, int fd, int oneshot) {
+  size_t len = 0, want;
+  ssize_t n;
+
+  for(;;) {
+    if(r->bufsize - len < 2) {
+      r->bufsize = r->bufsize ? 2 * r->bufsize : 4096;
+      r->buffer = xrealloc(r->buffer, r->bufsize);
+    }
+    want = r->bufsize - len - 1;
+    if((n = pread(fd, r->buffer + len, want, len)) < 0) {
+      if(errno == EINTR)
+        continue;
+      return -1;
+    }
+    len += n;
+    if(!n || (oneshot && (size_t)n < want))
+      break;
+  }
+  r->buffer[len] = 0;
+  return len;
+}
+
+/* Read the whole of WHAT for task T into R's buffer, returning the
+ * length or -1 on error.  The contents are followed by a 0 byte.  If
+ * ONESHOT is nonzero then a short read is taken to mean end of file,
+ * which is true for most /proc files and saves a system call. */
+static ssize_t reader_load(struct taskinfo *ti, struct reader *r,
+                           const struct task *t, const char *what,
+                           int oneshot) {
+  ssize_t len;
+  int fd, save_errno;
+
+  if(reader_open(ti, r, t) < 0)
+    return -1;
+  if((fd = openat(r->dirfd, what, O_RDONLY|O_CLOEXEC)) < 0)
+    return -1;
+  len = reader_read(r, fd, oneshot);
+  save_errno = errno;
+  close(fd);
+  errno = save_errno;
+  return len;
+}
+
+static void reader_close(struct reader *r) {
+  if(r->dirfd >= 0)
+    close(r->dirfd);
+  free(r->buffer);
+}
+
+// ----------------------------------------------------------------------------
+
+/* The stat, status and io files of recently used tasks are kept open,
+ * and handed on from one snapshot to the next, so that refreshing
+ * them is just a pread().  The number of FDs kept open is limited to
+ * a fraction of RLIMIT_NOFILE; when the limit is reached, the least
+ * recently used task's FDs are closed. */
+
+/* Upper limit on number of cached FDs */
+#define FDCACHE_MAX 16384
+
+static const char *const task_files[NTASKFILES] = {
+  "stat",
+  "status",
+  "io",
+};
+
+/* Protects all of the LRU lists and fdcache_count */
+static pthread_mutex_t fdcache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Number of cached FDs, across all snapshots */
+static size_t fdcache_count;
+
+/* Limit on fdcache_count, or SIZE_MAX if not known yet */
+static size_t fdcache_limit = SIZE_MAX;
+
+static size_t fdcache_budget(void) {
+  struct rlimit rl;
+
+  if(fdcache_limit == SIZE_MAX) {
+    if(getrlimit(RLIMIT_NOFILE, &rl) < 0 || rl.rlim_cur == RLIM_INFINITY)
+      fdcache_limit = FDCACHE_MAX;
+    else
+      fdcache_limit = min(rl.rlim_cur / 2, FDCACHE_MAX);
+  }
+  return fdcache_limit;
+}
+
+static void lru_unlink(struct taskinfo *ti, struct task *t) {
+  if(t->lru_prev != SIZE_MAX)
+    ti->tasks[t->lru_prev].lru_next = t->lru_next;
+  else
+    ti->lru_head = t->lru_next;
+  if(t->lru_next != SIZE_MAX)
+    ti->tasks[t->lru_next].lru_prev = t->lru_prev;
+  else
+    ti->lru_tail = t->lru_prev;
+  t->lru_prev = t->lru_next = SIZE_MAX;
+}
+
+static void lru_push(struct taskinfo *ti, struct task *t) {
+  size_t n = t - ti->tasks;
+  t->lru_prev = SIZE_MAX;
+  t->lru_next = ti->lru_head;
+  if(ti->lru_head != SIZE_MAX)
+    ti->tasks[ti->lru_head].lru_prev = n;
+  else
+    ti->lru_tail = n;
+  ti->lru_head = n;
+}
+
+static int task_cached(const struct task *t) {
+  size_t n;
+  for(n = 0; n < NTASKFILES; ++n)
+    if(t->fds[n] >= 0)
+      return 1;
+  return 0;
+}
+
+/* Close T's cached FDs.  The caller must hold fdcache_lock (or know
+ * that no other thread can be using it). */
+static void task_uncache_locked(struct taskinfo *ti, struct task *t) {
+  size_t n;
+  if(!task_cached(t))
+    return;
+  for(n = 0; n < NTASKFILES; ++n)
+    if(t->fds[n] >= 0) {
+      close(t->fds[n]);
+      t->fds[n] = -1;
+      --fdcache_count;
+    }
+  lru_unlink(ti, t);
+}
+
+static void task_uncache(struct taskinfo *ti, struct task *t) {
+  pthread_mutex_lock(&fdcache_lock);
+  task_uncache_locked(ti, t);
+  pthread_mutex_unlock(&fdcache_lock);
+}
+
+/* Move cached FDs from LAST to TI.  They must be validated against
+ * the task's start time before use, in case the PID has been
+ * reused. */
+static void task_inherit_fds(struct taskinfo *ti, struct taskinfo *last) {
+  struct task *t, *lastt;
+  size_t n;
+
+  pthread_mutex_lock(&fdcache_lock);
+  while(last->lru_tail != SIZE_MAX) {
+    lastt = &last->tasks[last->lru_tail];
+    if(lastt->stat && !lastt->vanished
+       && ti->procpath == last->procpath
+       && (t = task_find(ti, lastt->taskid))) {
+      for(n = 0; n < NTASKFILES; ++n) {
+        t->fds[n] = lastt->fds[n];
+        lastt->fds[n] = -1;
+      }
+      t->fds_inherited = 1;
+      lru_unlink(last, lastt);
+      lru_push(ti, t);
+    } else
+      task_uncache_locked(last, lastt);
+  }
+  pthread_mutex_unlock(&fdcache_lock);
+}
+
+/* Get an FD for file WHICH of task T.  *CACHED is set to nonzero if
+ * it is cached, otherwise the caller must close it. */
+static int task_file(struct taskinfo *ti, struct reader *r,
+                     struct task *t, int which, int *cached) {
+  int fd;
+
+  pthread_mutex_lock(&fdcache_lock);
+  if((fd = t->fds[which]) >= 0) {
+    lru_unlink(ti, t);
+    lru_push(ti, t);
+  }
+  pthread_mutex_unlock(&fdcache_lock);
+  if(fd >= 0) {
+    *cached = 1;
+    return fd;
+  }
+  if(reader_open(ti, r, t) < 0)
+    return -1;
+  if((fd = openat(r->dirfd, task_files[which], O_RDONLY|O_CLOEXEC)) < 0)
+    return -1;
+  pthread_mutex_lock(&fdcache_lock);
+  /* Another reader might be using the LRU task's FDs right now, so
+   * only evict when there are no others */
+  if(!r->shared
+     && fdcache_count >= fdcache_budget()
+     && ti->lru_tail != SIZE_MAX
+     && &ti->tasks[ti->lru_tail] != t)
+    task_uncache_locked(ti, &ti->tasks[ti->lru_tail]);
+  if(fdcache_count < fdcache_budget()) {
+    if(task_cached(t))
+      lru_unlink(ti, t);
+    lru_push(ti, t);
+    t->fds[which] = fd;
+    ++fdcache_count;
+    *cached = 1;
+  } else
+    *cached = 0;
+  pthread_mutex_unlock(&fdcache_lock);
+  return fd;
+}
+
+/* Like reader_load() but for the files with cached FDs */
+static ssize_t task_load(struct taskinfo *ti, struct reader *r,
+                         struct task *t, int which) {
+  ssize_t len;
+  int fd, cached, save_errno;
+
+  if((fd = task_file(ti, r, t, which, &cached)) < 0)
+    return -1;
+  len = reader_read(r, fd, 1);
+  if(!cached) {
+    save_errno = errno;
+    close(fd);
+    errno = save_errno;
+  } else if(len < 0) {
+    /* The cached FD may be stale; try again from scratch */
+    task_uncache(ti, t);
+    return reader_load(ti, r, t, task_files[which], 1);
+  }
+  return len;
+}
+
+/* Return the next line from *PTR, 0-terminating it and advancing
+ * *PTR past it.  Returns NULL at the end of the buffer.  If PARTIAL
+ * is not NULL then *PARTIAL is set to nonzero if the line was not
+ * terminated by a newline. */
+static char *next_line(char **ptr, int *partial) {
+  char *line = *ptr, *nl;
+
+  if(!*line)
+    return NULL;
+  if((nl = strchr(line, '\n'))) {
+    *nl = 0;
+    *ptr = nl + 1;
+    if(partial)
+      *partial = 0;
+  } else {
+    *ptr = line + strlen(line);
+    if(partial)
+      *partial = 1;
+  }
+  return line;
+}
+
+static void load_stat(struct taskinfo *ti, struct reader *r,
+                      struct task *t) {
+  struct stat_line sl;
+  ssize_t len;
 
   if(t->stat || t->vanished)
     return;
   t->stat = 1;
-  getpath(t, "stat", buffer, sizeof buffer);
-  if(!(fp = fopen(buffer, "r"))) {
+  if((len = task_load(ti, r, t, TF_STAT)) < 0) {
     task_vanished(ti, t->taskid.pid);
     return;
   }
-  field = 0;
-  if(fgets(buffer, sizeof buffer, fp)) {
-    bp = buffer;
-    while(*bp) {
-      if(*bp == ' ' || *bp == '\n') {
-        ++bp;
-        continue;
-      }
-      switch(field) {
-      default:
-	value = strtoumax(bp, &bp, 10);
-        if((field - 3) < NSTATS) {
-          ptr = (uintmax_t *)((char *)t + propinfo_stat[field - 3]);
-          *ptr = value;
-        }
-        break;
-      case 0:                   /* pid */
-        while(*bp && *bp != ' ')
-          ++bp;
-        break;
-      case 1:                   /* comm */
-        if(*bp == '(')
-          ++bp;
-        start = bp;
-        while(*bp && *bp != ')')
-          ++bp;
-        t->prop_comm = xstrndup(start, bp - start);
-        if(*bp)
-          ++bp;
-        break;
-      case 2:                   /* state */
-        t->prop_state = *bp++;
-        break;
-      }
-      field++;
-    }
+  stat_parse(r->buffer, len, &sl, t, propinfo_stat, NSTATS);
+  t->prop_state = sl.state;
+  if(sl.comm) {
+    if(t->base_comm && !strncmp(t->base_comm, sl.comm, sl.commlen)
+       && !t->base_comm[sl.commlen])
+      t->prop_comm = t->base_comm;
+    else
+      t->prop_comm = arena_strndup(r->arena, sl.comm, sl.commlen);
   }
   if(!t->prop_comm)
-    t->prop_comm = xstrdup("-");
-  fclose(fp);
+    t->prop_comm = arena_strdup(r->arena, "-");
+  if(t->fds_inherited) {
+    t->fds_inherited = 0;
+    if(t->prop_starttime != t->base_starttime) {
+      /* The PID has been reused; start again with fresh FDs */
+      task_uncache(ti, t);
+      t->prop_comm = NULL;
+      t->stat = 0;
+      load_stat(ti, r, t);
+      return;
+    }
+  }
   timespec_now(&t->stat_time);
 }
 
-static size_t parse_groups(const char *ptr,
-                           gid_t *groups,
-                           size_t max) {
+/* Parse a decimal number from *PTR, skipping leading spaces and tabs,
+ * and advance *PTR past it */
+static uintmax_t parse_decimal(const char **ptr) {
+  const char *p = *ptr;
+  uintmax_t value = 0;
+
+  while(*p == ' ' || *p == '\t')
+    ++p;
+  while(*p >= '0' && *p <= '9')
+    value = value * 10 + (*p++ - '0');
+  *ptr = p;
+  return value;
+}
+
+static size_t parse_groups(const char *ptr, const char *end,
+                           gid_t *groups, size_t max) {
   size_t ngroups = 0;
+  const char *start;
   gid_t gid;
-  char *end;
 
-  while(*ptr) {
-    if(*ptr == ' ' || *ptr == '\n') {
+  for(;;) {
+    while(ptr < end && (*ptr == ' ' || *ptr == '\t'))
       ++ptr;
-      continue;
-    }
-    gid = strtol(ptr, &end, 10);
-    ptr = end;
+    if(ptr >= end)
+      break;
+    start = ptr;
+    gid = parse_decimal(&ptr);
+    if(ptr == start)
+      break;
     if(groups && ngroups < max)
       groups[ngroups] = gid;
     ++ngroups;
@@ -434,10 +1190,9 @@ static size_t parse_groups(const char *ptr,
   return ngroups;
 }
 
-static void parse_sigset(sigset_t *ss, const char *ptr) {
+static void parse_sigset(sigbits sb, const char *ptr) {
   int ch, sig, d, bit;
-  if(sigemptyset(ss) < 0)
-    fatal(errno, "sigemptyset");
+  memset(sb, 0, sizeof (sigbits));
   ptr += strspn(ptr, " \t");
   /* The inverse of render_sigset_t in the kernel */
   sig = 4 * strspn(ptr, "0123456789abcdefABCDEF");
@@ -450,219 +1205,406 @@ static void parse_sigset(sigset_t *ss, const char *ptr) {
     else
       d = ch - ('a' - 10);
     for(bit = 8; bit >= 1; bit /= 2) {
-      if(d & bit)
-        if(sigaddset(ss, sig) < 0)
-          fatal(errno, "sigaddset");
+      if((d & bit) && sig <= 64 * SIGWORDS)
+        sb[(sig - 1) / 64] |= (uint64_t)1 << ((sig - 1) % 64);
       --sig;
     }
   }
 }
 
-static void task_status(struct taskinfo *ti, struct task *t) {
-  char buffer[1024], *ptr;
-  size_t i, n;
-  FILE *fp;
-  int c;
-  long e, r, s, f;
+static void sigbits_to_sigset(const sigbits sb, sigset_t *ss) {
+  int sig;
+  if(sigemptyset(ss) < 0)
+    fatal(errno, "sigemptyset");
+  for(sig = 1; sig <= 64 * SIGWORDS; ++sig)
+    if(sb[(sig - 1) / 64] & ((uint64_t)1 << ((sig - 1) % 64)))
+      /* glibc refuses to add the signals it reserves for itself */
+      if(sigaddset(ss, sig) < 0 && errno != EINVAL)
+        fatal(errno, "sigaddset");
+}
+
+/* The status_keys slots that SOURCES need */
+static unsigned status_wanted(unsigned sources) {
+  unsigned slot, wanted = 0;
+  for(slot = 0; slot < NSTATUS_SLOTS; ++slot)
+    if(status_keys[slot].sources & sources)
+      wanted |= 1u << slot;
+  return wanted;
+}
+
+static void load_status(struct taskinfo *ti, struct reader *r,
+                        struct task *t, unsigned sources) {
+  const struct status_key *k;
+  struct status_info *si;
+  const char *line, *eol, *colon, *ptr;
+  unsigned wanted, slot, found = 0;
+  uintmax_t ids[4];
+  size_t len, n;
 
-  if(t->status || t->vanished)
+  if(t->vanished)
     return;
-  t->status = 1;
-  getpath(t, "status", buffer, sizeof buffer);
-  if(!(fp = fopen(buffer, "r"))) {
+  si = t->status_info;
+  if(!(wanted = status_wanted(sources) & ~(si ? si->keys : 0)))
+    return;
+  /* Make sure any inherited FDs are validated before use */
+  if(t->fds_inherited)
+    load_stat(ti, r, t);
+  if(task_load(ti, r, t, TF_STATUS) < 0) {
     task_vanished(ti, t->taskid.pid);
     return;
   }
-  i = 0;
-  while((c = GETC(fp)) != EOF) {
-    if(c != '\n') {
-      if(i < sizeof buffer - 1)
-        buffer[i++] = c;
-    } else {
-      buffer[i] = 0;
-      if((ptr = strchr(buffer, ':'))) {
-        *ptr++ = 0;
-        while(*ptr && (*ptr == ' ' || *ptr == '\t'))
-          ++ptr;
-        if(buffer[0] == 'V' && buffer[1] == 'm') {
-          for(n = 0; n < NVMS; ++n)
-            if(!strcmp(buffer, propinfo_vm[n].name)) {
-              uintmax_t *u = (uintmax_t *)((char *)t + propinfo_vm[n].offset);
-              *u = strtoumax(ptr, NULL, 10);
-              t->vmbits |= propinfo_vm[n].bit;
-              break;
-            }
-        } else if(!strcmp(buffer, "Uid")
-           && sscanf(ptr, "%ld %ld %ld %ld", &r, &e, &s, &f) == 4) {
-          t->prop_ruid = r;
-          t->prop_euid = e;
-          t->prop_suid = s;
-          t->prop_fsuid = f;
-        } else if(!strcmp(buffer, "Gid")
-                  && sscanf(ptr, "%ld %ld %ld %ld", &r, &e, &s, &f) == 4) {
-          t->prop_rgid = r;
-          t->prop_egid = e;
-          t->prop_sgid = s;
-          t->prop_fsgid = f;
-        } else if(!strcmp(buffer, "Groups")) {
-          if(t->groups)
-            free(t->groups);
-          t->ngroups = parse_groups(ptr, NULL, 0);
-          t->groups = xrecalloc(NULL, t->ngroups, sizeof *t->groups);
-          parse_groups(ptr, t->groups, t->ngroups);
-        } else if(!strcmp(buffer, "SigPnd"))
-          parse_sigset(&t->sigpending, ptr);
-        else if(!strcmp(buffer, "SigBlk"))
-          parse_sigset(&t->sigblocked, ptr);
-        else if(!strcmp(buffer, "SigIgn"))
-          parse_sigset(&t->sigignored, ptr);
-        else if(!strcmp(buffer, "SigCgt"))
-          parse_sigset(&t->sigcaught, ptr);
-      }
-      i = 0;
+  if(!si)
+    t->status_info = si = arena_calloc(r->arena, 1, sizeof *si);
+  /* Keys that are absent are not looked for again */
+  si->keys |= wanted;
+  for(line = r->buffer; *line && found != wanted; line = eol + !!*eol) {
+    eol = strchrnul(line, '\n');
+    if(!(colon = memchr(line, ':', eol - line)))
+      continue;
+    len = colon - line;
+    if(len < STATUS_KEYMIN || len > STATUS_KEYMAX)
+      continue;
+    slot = STATUS_HASH(line[0], line[2], line[3], len);
+    k = &status_keys[slot];
+    if(!(wanted & (1u << slot)) || k->len != len
+       || memcmp(line, k->name, len))
+      continue;
+    found |= 1u << slot;
+    ptr = colon + 1;
+    switch(k->type) {
+    case STATUS_VM:
+      *(uintmax_t *)((char *)si + k->offset) = parse_decimal(&ptr);
+      si->vmbits |= k->bit;
+      break;
+    case STATUS_UIDS:
+      for(n = 0; n < 4; ++n)
+        ids[n] = parse_decimal(&ptr);
+      si->prop_ruid = ids[0];
+      si->prop_euid = ids[1];
+      si->prop_suid = ids[2];
+      si->prop_fsuid = ids[3];
+      break;
+    case STATUS_GIDS:
+      for(n = 0; n < 4; ++n)
+        ids[n] = parse_decimal(&ptr);
+      si->prop_rgid = ids[0];
+      si->prop_egid = ids[1];
+      si->prop_sgid = ids[2];
+      si->prop_fsgid = ids[3];
+      break;
+    case STATUS_GROUPS:
+      si->ngroups = parse_groups(ptr, eol, NULL, 0);
+      si->groups = arena_calloc(r->arena, si->ngroups, sizeof *si->groups);
+      parse_groups(ptr, eol, si->groups, si->ngroups);
+      break;
+    case STATUS_SIG:
+      parse_sigset(*(sigbits *)((char *)si + k->offset), ptr);
+      break;
     }
   }
-  fclose(fp);
 }
 
-static void task_cmdline(struct taskinfo *ti, struct task *t) {
-  char buffer[1024];
-  size_t i;
-  FILE *fp;
-  int c, trailing_space = 0;
+/* Longest command line retained */
+#define CMDLINE_MAX 1023
 
+static void load_cmdline(struct taskinfo *ti, struct reader *r,
+                         struct task *t) {
+  ssize_t len;
+  size_t i, n;
+  char *buffer;
+  int trailing_nul;
+
+  if(t->cmdline_inherited) {
+    /* Keep the previous command line if the task is the same process
+     * and hasn't called execve() or exited since */
+    t->cmdline_inherited = 0;
+    load_stat(ti, r, t);
+    if(!t->vanished
+       && t->prop_starttime == t->base_starttime
+       && t->prop_comm == t->base_comm
+       && t->prop_state != 'Z')
+      return;
+    t->prop_cmdline = NULL;
+    t->cmdline_age = 0;
+  }
   if(t->prop_cmdline || t->vanished)
     return;
-  getpath(t, "cmdline", buffer, sizeof buffer);
-  if(!(fp = fopen(buffer, "r"))) {
+  if((len = reader_load(ti, r, t, "cmdline", 1)) < 0) {
     task_vanished(ti, t->taskid.pid);
     return;
   }
-  i = 0;
-  while((c = GETC(fp)) != EOF) {
-    if(!c) {
-      c = ' ';
-      trailing_space = 1;
-    } else
-      trailing_space = 0;
-    if(i < sizeof buffer - 1)
-      buffer[i++] = c;
-  }
-  fclose(fp);
-  if(trailing_space)
-    --i;
-  buffer[i] = 0;
-  t->prop_cmdline = xstrdup(buffer);
+  buffer = r->buffer;
+  /* Arguments are 0-terminated; drop the final terminator */
+  trailing_nul = len > 0 && !buffer[len - 1];
+  n = min((size_t)len, CMDLINE_MAX);
+  for(i = 0; i < n; ++i)
+    if(!buffer[i])
+      buffer[i] = ' ';
+  if(trailing_nul)
+    --n;
+  t->prop_cmdline = arena_strndup(r->arena, buffer, n);
 }
 
 struct priv_callback_data {
-  char path[128];
   struct taskinfo *ti;
+  struct reader *r;
   struct task *t;
 };
 
 static int read_io(void *u) {
   struct priv_callback_data *d = u;
-  char buffer[1024], *colon;
+  char *bp, *line, *colon;
   size_t field;
   uintmax_t *ptr;
-  FILE *fp;
+  int partial;
 
-  if(!(fp = fopen(d->path, "r"))) {
+  if(task_load(d->ti, d->r, d->t, TF_IO) < 0) {
     if(errno != EACCES)
       task_vanished(d->ti, d->t->taskid.pid);
     return -1;
   }
   field = 0;
-  while(fgets(buffer, sizeof buffer, fp)) {
-    if(!strchr(buffer, '\n')) {
-      fclose(fp);
+  bp = d->r->buffer;
+  while((line = next_line(&bp, &partial))) {
+    if(partial)
       return -1;
-    }
-    colon = strchr(buffer, ':');
+    colon = strchr(line, ':');
     if(colon) {
       ++colon;
       if(field < NIOS) {
-        ptr = (uintmax_t *)((char *)d->t + propinfo_io[field]);
+        ptr = (uintmax_t *)((char *)d->t->io_info + propinfo_io[field]);
         *ptr = strtoumax(colon + 1, NULL, 10);
       }
       ++field;
     }
   }
-  fclose(fp);
   return 0;
 }
 
-static void task_io(struct taskinfo *ti, struct task *t) {
+static void load_io(struct taskinfo *ti, struct reader *r,
+                    struct task *t) {
   struct priv_callback_data d[1];
 
   if(t->io || t->vanished)
     return;
+  if(t->fds_inherited)
+    load_stat(ti, r, t);
   t->io = 1;
-  getpath(t, "io", d->path, sizeof d->path);
+  if(!t->io_info)
+    t->io_info = arena_calloc(r->arena, 1, sizeof *t->io_info);
   d->ti = ti;
+  d->r = r;
   d->t = t;
   priv_run(read_io, d);
-  timespec_now(&t->io_time);
+  timespec_now(&t->io_info->io_time);
 }
 
-static void task_oom_score(struct taskinfo *ti, struct task *t) {
-  char buffer[128];
-  FILE *fp;
+static void load_oom_score(struct taskinfo *ti, struct reader *r,
+                           struct task *t) {
+  char *end;
   if(t->oom_score_set || t->vanished)
     return;
   t->oom_score_set =1;
-  getpath(t, "oom_score", buffer, sizeof buffer);
-  if(!(fp = fopen(buffer, "r"))) {
+  if(reader_load(ti, r, t, "oom_score", 1) < 0) {
     task_vanished(ti, t->taskid.pid);
     return;
   }
-  if(fscanf(fp, "%jd", &t->oom_score) < 0)
+  t->oom_score = strtoimax(r->buffer, &end, 10);
+  if(end == r->buffer)
     task_vanished(ti, t->taskid.pid);
-  fclose(fp);
 }
 
 static int read_smaps(void *u) {
   struct priv_callback_data *d = u;
-  char buffer[1024], *ptr;
-  FILE *fp;
-
-  if(!(fp = fopen(d->path, "r"))) {
+  char *bp, *line, *ptr;
+  int partial;
+
+  /* smaps_rollup (Linux 4.14 onwards) has the totals already summed
+   * up, and is much smaller than smaps for processes with many
+   * mappings.  The line format is the same. */
+  if((!task_smaps_rollup
+      || reader_load(d->ti, d->r, d->t, "smaps_rollup", 1) < 0)
+     && reader_load(d->ti, d->r, d->t, "smaps", 0) < 0) {
     if(errno != EACCES)
       task_vanished(d->ti, d->t->taskid.pid);
     return -1;
   }
-  while(fgets(buffer, sizeof buffer, fp)) {
-    if(!strchr(buffer, '\n')) {
-      fclose(fp);
+  bp = d->r->buffer;
+  while((line = next_line(&bp, &partial))) {
+    if(partial)
       return -1;
-    }
-    if(buffer[0] >= 'A' && buffer[0] <= 'Z'
-       && (ptr = strchr(buffer, ':'))) {
+    if(line[0] >= 'A' && line[0] <= 'Z'
+       && (ptr = strchr(line, ':'))) {
       *ptr++ = 0;
-      if(!strcmp(buffer, "Pss"))
+      if(!strcmp(line, "Pss"))
         d->t->prop_pss += strtoumax(ptr, NULL, 0);
-      else if(!strcmp(buffer, "Swap"))
+      else if(!strcmp(line, "Swap"))
         d->t->prop_swap += strtoumax(ptr, NULL, 0);
     }
   }
   d->t->pss = 1;
-  fclose(fp);
   return 0;
 }
 
-static void task_smaps(struct taskinfo *ti, struct task *t) {
+static void load_smaps(struct taskinfo *ti, struct reader *r,
+                       struct task *t) {
   struct priv_callback_data d[1];
   if(t->smaps || t->vanished)
     return;
   t->smaps = 1;
-  getpath(t, "smaps", d->path, sizeof d->path);
   d->ti = ti;
+  d->r = r;
   d->t = t;
   t->prop_pss = t->prop_swap = 0;
   priv_run(read_smaps, d);
 }
 
+static void task_stat(struct taskinfo *ti, struct task *t) {
+  load_stat(ti, &ti->reader, t);
+}
+
+/* Side tables for tasks whose file could not be read */
+static const struct status_info no_status;
+static const struct io_info no_io;
+
+static const struct status_info *task_status(struct taskinfo *ti,
+                                             struct task *t,
+                                             unsigned sources) {
+  load_status(ti, &ti->reader, t, sources);
+  return t->status_info ? t->status_info : &no_status;
+}
+
+static void task_cmdline(struct taskinfo *ti, struct task *t) {
+  load_cmdline(ti, &ti->reader, t);
+}
+
+static const struct io_info *task_io(struct taskinfo *ti, struct task *t) {
+  load_io(ti, &ti->reader, t);
+  return t->io_info ? t->io_info : &no_io;
+}
+
+static void task_oom_score(struct taskinfo *ti, struct task *t) {
+  load_oom_score(ti, &ti->reader, t);
+}
+
+static void task_smaps(struct taskinfo *ti, struct task *t) {
+  load_smaps(ti, &ti->reader, t);
+}
+
+// ----------------------------------------------------------------------------
+
+/* Properties are normally loaded one file at a time, on first use.
+ * When the caller knows in advance which sources it will need, it
+ * can load them for all tasks at once, and in parallel.
+ *
+ * Work is divided up by process (with its threads), since
+ * task_vanished() updates all the tasks of a process. */
+
+struct prefetch {
+  struct taskinfo *ti;
+  struct reader *readers;       /* one per worker */
+  struct arena *arenas;         /* one per worker */
+  size_t *groups;               /* index of first task of each process */
+  size_t ngroups;
+  unsigned sources;
+};
+
+static void task_load_sources(struct taskinfo *ti, struct reader *r,
+                              struct task *t, unsigned sources) {
+  if(sources & TASK_SRC_STAT)
+    load_stat(ti, r, t);
+  if(sources & TASK_SRC_STATUS)
+    load_status(ti, r, t, sources);
+  if(sources & TASK_SRC_CMDLINE)
+    load_cmdline(ti, r, t);
+  if(sources & TASK_SRC_IO)
+    load_io(ti, r, t);
+  if(sources & TASK_SRC_OOM)
+    load_oom_score(ti, r, t);
+  if(sources & TASK_SRC_SMAPS)
+    load_smaps(ti, r, t);
+}
+
+static void task_prefetch_group(struct prefetch *p, struct reader *r,
+                                size_t group, unsigned sources) {
+  struct taskinfo *ti = p->ti;
+  size_t n = p->groups[group];
+  pid_t pid = ti->tasks[n].taskid.pid;
+
+  for(; n < ti->ntasks && ti->tasks[n].taskid.pid == pid; ++n)
+    if(ti->tasks[n].prefetch)
+      task_load_sources(ti, r, &ti->tasks[n], sources);
+}
+
+static void task_prefetch_worker(void *u, size_t i, unsigned worker) {
+  struct prefetch *p = u;
+  task_prefetch_group(p, &p->readers[worker], i, p->sources);
+}
+
+/* Load SOURCES for all tasks with the prefetch bit set, and clear it */
+static void task_prefetch_marked(struct taskinfo *ti, unsigned sources) {
+  struct prefetch p[1];
+  unsigned workers, serial = 0, w;
+  size_t n, end;
+  pid_t pid;
+  int wanted;
+
+  p->ti = ti;
+  p->groups = xrecalloc(NULL, ti->ntasks, sizeof *p->groups);
+  p->ngroups = 0;
+  for(n = 0; n < ti->ntasks; n = end) {
+    pid = ti->tasks[n].taskid.pid;
+    wanted = 0;
+    for(end = n; end < ti->ntasks && ti->tasks[end].taskid.pid == pid; ++end)
+      wanted |= ti->tasks[end].prefetch;
+    if(wanted)
+      p->groups[p->ngroups++] = n;
+  }
+  workers = parallel_workers(task_workers, p->ngroups);
+  if(workers > 1) {
+    /* Privilege is process-wide so privileged reads must be serial */
+    if(privileged())
+      serial = sources & (TASK_SRC_IO|TASK_SRC_SMAPS);
+    p->sources = sources & ~serial;
+    p->readers = xrecalloc(NULL, workers, sizeof *p->readers);
+    memset(p->readers, 0, workers * sizeof *p->readers);
+    p->arenas = xrecalloc(NULL, workers, sizeof *p->arenas);
+    memset(p->arenas, 0, workers * sizeof *p->arenas);
+    for(w = 0; w < workers; ++w) {
+      p->readers[w].dirfd = -1;
+      p->readers[w].shared = 1;
+      p->readers[w].arena = &p->arenas[w];
+    }
+    parallel_run(p->ngroups, workers, task_prefetch_worker, p);
+    for(w = 0; w < workers; ++w) {
+      reader_close(&p->readers[w]);
+      arena_merge(&ti->arena, &p->arenas[w]);
+    }
+    free(p->readers);
+    free(p->arenas);
+  } else
+    serial = sources;
+  if(serial)
+    for(n = 0; n < p->ngroups; ++n)
+      task_prefetch_group(p, &ti->reader, n, serial);
+  for(n = 0; n < ti->ntasks; ++n)
+    ti->tasks[n].prefetch = 0;
+  free(p->groups);
+}
+
+void task_prefetch(struct taskinfo *ti, const taskident *tasks,
+                   size_t ntasks, unsigned sources) {
+  struct task *t;
+  size_t n;
+
+  if(!sources || !ntasks)
+    return;
+  for(n = 0; n < ntasks; ++n)
+    if((t = task_find(ti, tasks[n])))
+      t->prefetch = 1;
+  task_prefetch_marked(ti, sources);
+}
+
 // ----------------------------------------------------------------------------
 
 pid_t task_get_pid(struct taskinfo attribute((unused)) *ti, taskident taskid) {
@@ -683,57 +1625,49 @@ pid_t task_get_session(struct taskinfo *ti, taskident taskid) {
 uid_t task_get_ruid(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
 
-  task_status(ti, t);
-  return t->prop_ruid;
+  return task_status(ti, t, TASK_SRC_STATUS_IDS)->prop_ruid;
 }
 
 uid_t task_get_euid(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
 
-  task_status(ti, t);
-  return t->prop_euid;
+  return task_status(ti, t, TASK_SRC_STATUS_IDS)->prop_euid;
 }
 
 uid_t task_get_suid(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
 
-  task_status(ti, t);
-  return t->prop_suid;
+  return task_status(ti, t, TASK_SRC_STATUS_IDS)->prop_suid;
 }
 
 uid_t task_get_fsuid(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
 
-  task_status(ti, t);
-  return t->prop_fsuid;
+  return task_status(ti, t, TASK_SRC_STATUS_IDS)->prop_fsuid;
 }
 
 gid_t task_get_rgid(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
 
-  task_status(ti, t);
-  return t->prop_rgid;
+  return task_status(ti, t, TASK_SRC_STATUS_IDS)->prop_rgid;
 }
 
 gid_t task_get_egid(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
 
-  task_status(ti, t);
-  return t->prop_egid;
+  return task_status(ti, t, TASK_SRC_STATUS_IDS)->prop_egid;
 }
 
 gid_t task_get_sgid(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
 
-  task_status(ti, t);
-  return t->prop_sgid;
+  return task_status(ti, t, TASK_SRC_STATUS_IDS)->prop_sgid;
 }
 
 gid_t task_get_fsgid(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
 
-  task_status(ti, t);
-  return t->prop_fsgid;
+  return task_status(ti, t, TASK_SRC_STATUS_IDS)->prop_fsgid;
 }
 
 pid_t task_get_ppid(struct taskinfo *ti, taskident taskid) {
@@ -778,9 +1712,14 @@ const char *task_get_cmdline(struct taskinfo *ti, taskident taskid) {
   if(!t->prop_cmdline || !*t->prop_cmdline) {
     /* "Failing this, the command name, as it would appear without the
      * option -f, is written in square brackets. */
-    free(t->prop_cmdline);
+    const char *comm;
+    size_t len;
     task_stat(ti, t);
-    xasprintf(&t->prop_cmdline, "[%s]", t->prop_comm);
+    /* A task that vanished before its stat was read has no name */
+    comm = t->prop_comm ? t->prop_comm : "-";
+    len = strlen(comm) + 3;
+    t->prop_cmdline = arena_alloc(&ti->arena, len);
+    snprintf(t->prop_cmdline, len, "[%s]", comm);
   }
   return t->prop_cmdline;
 }
@@ -872,30 +1811,28 @@ double task_get_pcpu(struct taskinfo *ti, taskident taskid) {
 
 uintmax_t task_get_vsize(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
-  if(t->vmbits & bit_VmSize)
-    return t->prop_VmSize * KILOBYTE;
+  if(t->status_info && (t->status_info->vmbits & bit_VmSize))
+    return t->status_info->prop_VmSize * KILOBYTE;
   task_stat(ti, t);
   return t->prop_vsize;
 }
 
 uintmax_t task_get_peak_vsize(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
-  task_status(ti, t);
-  return t->prop_VmPeak * KILOBYTE;
+  return task_status(ti, t, TASK_SRC_STATUS_VM)->prop_VmPeak * KILOBYTE;
 }
 
 uintmax_t task_get_rss(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
-  if(t->vmbits & bit_VmRSS)
-    return t->prop_VmRSS * KILOBYTE;
+  if(t->status_info && (t->status_info->vmbits & bit_VmRSS))
+    return t->status_info->prop_VmRSS * KILOBYTE;
   task_stat(ti, t);
   return t->prop_rss * sysconf(_SC_PAGESIZE);
 }
 
 uintmax_t task_get_peak_rss(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
-  task_status(ti, t);
-  return t->prop_VmHWM * KILOBYTE;
+  return task_status(ti, t, TASK_SRC_STATUS_VM)->prop_VmHWM * KILOBYTE;
 }
 
 uintmax_t task_get_insn_pointer(struct taskinfo *ti, taskident taskid) {
@@ -912,38 +1849,38 @@ uintmax_t task_get_wchan(struct taskinfo *ti, taskident taskid) {
 
 double task_get_rchar(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
-  task_io(ti, t);
-  return task_rate(t, t->base_io_time, t->io_time,
-                   t->prop_rchar - t->base_rchar);
+  const struct io_info *io = task_io(ti, t);
+  return task_rate(t, io->base_io_time, io->io_time,
+                   io->prop_rchar - io->base_rchar);
 }
 
 double task_get_wchar(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
-  task_io(ti, t);
-  return task_rate(t, t->base_io_time, t->io_time,
-                   t->prop_wchar - t->base_wchar);
+  const struct io_info *io = task_io(ti, t);
+  return task_rate(t, io->base_io_time, io->io_time,
+                   io->prop_wchar - io->base_wchar);
 }
 
 double task_get_read_bytes(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
-  task_io(ti, t);
-  return task_rate(t, t->base_io_time, t->io_time,
-                   t->prop_read_bytes - t->base_read_bytes);
+  const struct io_info *io = task_io(ti, t);
+  return task_rate(t, io->base_io_time, io->io_time,
+                   io->prop_read_bytes - io->base_read_bytes);
 }
 
 double task_get_write_bytes(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
-  task_io(ti, t);
-  return task_rate(t, t->base_io_time, t->io_time,
-                   t->prop_write_bytes - t->base_write_bytes);
+  const struct io_info *io = task_io(ti, t);
+  return task_rate(t, io->base_io_time, io->io_time,
+                   io->prop_write_bytes - io->base_write_bytes);
 }
 
 double task_get_rw_bytes(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
-  task_io(ti, t);
-  return task_rate(t, t->base_io_time, t->io_time,
-                   t->prop_read_bytes + t->prop_write_bytes
-                   - t->base_read_bytes - t->base_write_bytes);
+  const struct io_info *io = task_io(ti, t);
+  return task_rate(t, io->base_io_time, io->io_time,
+                   io->prop_read_bytes + io->prop_write_bytes
+                   - io->base_read_bytes - io->base_write_bytes);
 }
 
 intmax_t task_get_oom_score(struct taskinfo *ti, taskident taskid) {
@@ -974,11 +1911,11 @@ uintmax_t task_get_pss(struct taskinfo *ti, taskident taskid) {
 
 uintmax_t task_get_swap(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
-  task_status(ti, t);
+  const struct status_info *si = task_status(ti, t, TASK_SRC_STATUS_VM);
   /* Since 2.6.34 (b084d4353ff99d824d3bc5a5c2c22c70b1fba722), swap
    * usage has been exposed directly */
-  if(t->vmbits & bit_VmSwap)
-    return t->prop_VmSwap * KILOBYTE;
+  if(si->vmbits & bit_VmSwap)
+    return si->prop_VmSwap * KILOBYTE;
   /* Prior to that we have to work it out by adding up smaps entries */
   task_smaps(ti, t);
   return t->prop_swap * KILOBYTE;
@@ -1007,10 +1944,10 @@ int task_get_num_threads(struct taskinfo *ti, taskident taskid) {
 const gid_t *task_get_supgids(struct taskinfo *ti, taskident taskid,
                               size_t *countp) {
   struct task *t = task_find(ti, taskid);
-  task_status(ti, t);
+  const struct status_info *si = task_status(ti, t, TASK_SRC_STATUS_GROUPS);
   if(countp)
-    *countp = t->ngroups;
-  return t->groups;
+    *countp = si->ngroups;
+  return si->groups;
 }
 
 uintmax_t task_get_rtprio(struct taskinfo *ti, taskident taskid) {
@@ -1028,80 +1965,315 @@ int task_get_sched_policy(struct taskinfo *ti, taskident taskid) {
 void task_get_sig_pending(struct taskinfo *ti, taskident taskid,
                           sigset_t *signals) {
   struct task *t = task_find(ti, taskid);
-  task_status(ti, t);
-  *signals = t->sigpending;
+  sigbits_to_sigset(task_status(ti, t, TASK_SRC_STATUS_SIGNALS)->sigpending, signals);
 }
 
 void task_get_sig_blocked(struct taskinfo *ti, taskident taskid,
                           sigset_t *signals) {
   struct task *t = task_find(ti, taskid);
-  task_status(ti, t);
-  *signals = t->sigblocked;
+  sigbits_to_sigset(task_status(ti, t, TASK_SRC_STATUS_SIGNALS)->sigblocked, signals);
 }
 
 void task_get_sig_ignored(struct taskinfo *ti, taskident taskid,
                           sigset_t *signals) {
   struct task *t = task_find(ti, taskid);
-  task_status(ti, t);
-  *signals = t->sigignored;
+  sigbits_to_sigset(task_status(ti, t, TASK_SRC_STATUS_SIGNALS)->sigignored, signals);
 }
 
 void task_get_sig_caught(struct taskinfo *ti, taskident taskid,
                           sigset_t *signals) {
   struct task *t = task_find(ti, taskid);
-  task_status(ti, t);
-  *signals = t->sigcaught;
+  sigbits_to_sigset(task_status(ti, t, TASK_SRC_STATUS_SIGNALS)->sigcaught, signals);
 }
 
 uintmax_t task_get_stack(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
-  task_status(ti, t);
-  return t->prop_VmStk * KILOBYTE;
+  return task_status(ti, t, TASK_SRC_STATUS_VM)->prop_VmStk * KILOBYTE;
 }
 
 uintmax_t task_get_locked(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
-  task_status(ti, t);
-  return t->prop_VmLck * KILOBYTE;
+  return task_status(ti, t, TASK_SRC_STATUS_VM)->prop_VmLck * KILOBYTE;
 }
 
 uintmax_t task_get_pinned(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
-  task_status(ti, t);
-  return t->prop_VmPin * KILOBYTE;
+  return task_status(ti, t, TASK_SRC_STATUS_VM)->prop_VmPin * KILOBYTE;
 }
 
 uintmax_t task_get_pte(struct taskinfo *ti, taskident taskid) {
   struct task *t = task_find(ti, taskid);
-  task_status(ti, t);
-  return t->prop_VmPTE * KILOBYTE;
+  return task_status(ti, t, TASK_SRC_STATUS_VM)->prop_VmPTE * KILOBYTE;
 }
 
 // ----------------------------------------------------------------------------
 
+/* A node of the process tree, for sorting by PID */
+struct tree_node {
+  pid_t pid;
+  size_t n;                     /* index into tasks array */
+};
+
+static int tree_node_compare(const void *av, const void *bv) {
+  const struct tree_node *a = av, *b = bv;
+  if(a->pid != b->pid)
+    return a->pid < b->pid ? -1 : 1;
+  return a->n < b->n ? -1 : a->n > b->n;
+}
+
+/* Build the process tree, if it does not already exist.
+ *
+ * Each task gets the position of its process in a depth-first
+ * traversal of the tree, and the depth of its process.  Children
+ * follow their parent and siblings are visited in PID order, so
+ * sorting by position gives the same order as the recursive
+ * comparison used to.  Threads share their process's values. */
+static void task_tree(struct taskinfo *ti) {
+  struct tree_node *nodes;
+  size_t n, i, j, p, nnodes = 0, sp = 0, rank = 0;
+  size_t *owner, *parent, *first, *children, *stack, *byrank;
+  struct task *t;
+  int sorted = 1, pass;
+
+  if(ti->tree_rank || !ti->ntasks)
+    return;
+  /* Every process's parent is needed */
+  for(n = 0; n < ti->ntasks; ++n)
+    if(ti->tasks[n].taskid.tid == -1)
+      ti->tasks[n].prefetch = 1;
+  task_prefetch_marked(ti, TASK_SRC_STAT);
+  /* Identify the nodes.  A thread whose process is missing is
+   * treated as a process in its own right. */
+  owner = xrecalloc(NULL, ti->ntasks, sizeof *owner);
+  nodes = xrecalloc(NULL, ti->ntasks, sizeof *nodes);
+  for(n = 0; n < ti->ntasks; ++n) {
+    t = &ti->tasks[n];
+    if(t->taskid.tid == -1)
+      owner[n] = n;
+    else {
+      taskident process = { t->taskid.pid, -1 };
+      if((owner[n] = taskindex_find(&ti->index, process)) == SIZE_MAX)
+        owner[n] = n;
+    }
+    if(owner[n] == n) {
+      nodes[nnodes].pid = t->taskid.pid;
+      nodes[nnodes].n = n;
+      if(nnodes && tree_node_compare(&nodes[nnodes - 1], &nodes[nnodes]) > 0)
+        sorted = 0;
+      ++nnodes;
+    }
+  }
+  if(!sorted)
+    qsort(nodes, nnodes, sizeof *nodes, tree_node_compare);
+  /* Find each node's parent and count its children */
+  parent = ti->tree_parent = arena_alloc(&ti->arena,
+                                         ti->ntasks * sizeof *parent);
+  first = xrecalloc(NULL, ti->ntasks + 1, sizeof *first);
+  memset(first, 0, (ti->ntasks + 1) * sizeof *first);
+  for(i = 0; i < nnodes; ++i) {
+    n = nodes[i].n;
+    t = &ti->tasks[n];
+    p = SIZE_MAX;
+    if(t->taskid.tid == -1 && t->stat && !t->vanished
+       && t->prop_ppid != t->taskid.pid) {
+      taskident ptask = { t->prop_ppid, -1 };
+      p = taskindex_find(&ti->index, ptask);
+    }
+    parent[n] = p;
+    if(p != SIZE_MAX)
+      ++first[p + 1];
+  }
+  for(n = 0; n < ti->ntasks; ++n)
+    first[n + 1] += first[n];
+  /* Fill in the child lists.  Visiting nodes in PID order keeps each
+   * list in PID order.  first[p] is used as a cursor and ends up as
+   * the end of p's children, i.e. the start of p+1's. */
+  children = xrecalloc(NULL, nnodes, sizeof *children);
+  for(i = 0; i < nnodes; ++i) {
+    n = nodes[i].n;
+    if((p = parent[n]) != SIZE_MAX)
+      children[first[p]++] = n;
+  }
+  memmove(first + 1, first, ti->ntasks * sizeof *first);
+  first[0] = 0;
+  /* Depth-first traversal from each root in PID order.  Any nodes
+   * left over are on a cycle, which can only arise from inconsistent
+   * reads; they are picked up by a second pass. */
+  ti->tree_rank = arena_alloc(&ti->arena,
+                              ti->ntasks * sizeof *ti->tree_rank);
+  ti->tree_depth = arena_alloc(&ti->arena,
+                               ti->ntasks * sizeof *ti->tree_depth);
+  ti->tree_end = arena_alloc(&ti->arena, ti->ntasks * sizeof *ti->tree_end);
+  ti->tree_root = arena_alloc(&ti->arena,
+                              ti->ntasks * sizeof *ti->tree_root);
+  for(n = 0; n < ti->ntasks; ++n)
+    ti->tree_rank[n] = SIZE_MAX;
+  stack = xrecalloc(NULL, nnodes, sizeof *stack);
+  byrank = ti->tree_order = arena_alloc(&ti->arena,
+                                        nnodes * sizeof *byrank);
+  ti->tree_nodes = nnodes;
+  for(pass = 0; pass < 2; ++pass) {
+    for(i = 0; i < nnodes; ++i) {
+      n = nodes[i].n;
+      if(ti->tree_rank[n] != SIZE_MAX || (!pass && parent[n] != SIZE_MAX))
+        continue;
+      ti->tree_depth[n] = 0;
+      stack[sp++] = n;
+      while(sp) {
+        p = stack[--sp];
+        byrank[rank] = p;
+        ti->tree_rank[p] = rank++;
+        ti->tree_end[p] = rank;
+        /* Push in reverse so that the lowest PID is visited first */
+        for(j = first[p + 1]; j > first[p]; --j) {
+          n = children[j - 1];
+          if(ti->tree_rank[n] == SIZE_MAX) {
+            ti->tree_depth[n] = ti->tree_depth[p] + 1;
+            stack[sp++] = n;
+          }
+        }
+      }
+    }
+  }
+  /* Each subtree occupies a contiguous range of positions starting
+   * at its root.  Working backwards, every child's range is complete
+   * by the time it is propagated to its parent.  (A node whose parent
+   * comes later is where a cycle was broken.) */
+  for(rank = nnodes; rank > 0; --rank) {
+    n = byrank[rank - 1];
+    p = parent[n];
+    if(p != SIZE_MAX && ti->tree_rank[p] < rank - 1
+       && ti->tree_end[p] < ti->tree_end[n])
+      ti->tree_end[p] = ti->tree_end[n];
+  }
+  for(rank = 0; rank < nnodes; ++rank) {
+    n = byrank[rank];
+    ti->tree_root[n] = ti->tree_depth[n] ? ti->tree_root[parent[n]] : n;
+  }
+  /* Threads inherit their process's position */
+  for(n = 0; n < ti->ntasks; ++n)
+    if(owner[n] != n) {
+      ti->tree_rank[n] = ti->tree_rank[owner[n]];
+      ti->tree_depth[n] = ti->tree_depth[owner[n]];
+      ti->tree_end[n] = ti->tree_end[owner[n]];
+      ti->tree_root[n] = ti->tree_root[owner[n]];
+    }
+  free(stack);
+  free(children);
+  free(first);
+  free(nodes);
+  free(owner);
+}
+
 int task_get_depth(struct taskinfo *ti, taskident taskid) {
-  struct task *t = task_find(ti, taskid);
-  if(!t)
+  size_t n = taskindex_find(&ti->index, taskid);
+  if(n == SIZE_MAX)
     return -1;
-  task_stat(ti, t);
-  if(taskid.pid == t->prop_ppid)
-    return 0;
-  else {
-    taskident parent = { t->prop_ppid, -1 };
-    return task_get_depth(ti, parent) + 1;
-  }
+  task_tree(ti);
+  return ti->tree_depth[n];
+}
+
+size_t task_get_tree_rank(struct taskinfo *ti, taskident taskid) {
+  size_t n = taskindex_find(&ti->index, taskid);
+  if(n == SIZE_MAX)
+    return SIZE_MAX;
+  task_tree(ti);
+  return ti->tree_rank[n];
 }
 
 int task_is_ancestor(struct taskinfo *ti, taskident a, taskident b) {
+  size_t an, bn = taskindex_find(&ti->index, b);
   struct task *t;
   if(b.pid == a.pid)
     return 1;
-  t = task_find(ti, b);
-  if(!t)
+  if(bn == SIZE_MAX)
     return 0;
-  task_stat(ti, t);
-  taskident parent = { t->prop_ppid, -1 };
-  return task_is_ancestor(ti, a, parent);
+  a.tid = -1;
+  if((an = taskindex_find(&ti->index, a)) != SIZE_MAX) {
+    task_tree(ti);
+    return (ti->tree_rank[an] <= ti->tree_rank[bn]
+            && ti->tree_rank[bn] < ti->tree_end[an]);
+  }
+  /* A may be a process that wasn't enumerated (for instance, it
+   * exited during the scan).  Only a root can have a missing parent,
+   * so the answer depends only on the root of B's tree. */
+  task_tree(ti);
+  t = &ti->tasks[ti->tree_root[bn]];
+  return t->stat && t->prop_ppid == a.pid;
+}
+
+/* Return the subtree totals of GET, computing them if necessary.
+ * Each process's total is its own value plus its children's totals,
+ * so visiting processes in reverse order of position finds them all
+ * in one pass.  SOURCES are loaded for every process first. */
+static const double *task_tree_total(struct taskinfo *ti, double **totalsp,
+                                     unsigned sources,
+                                     double (*get)(struct taskinfo *,
+                                                   taskident)) {
+  double *totals;
+  size_t n, p, r;
+
+  if(*totalsp)
+    return *totalsp;
+  task_tree(ti);
+  for(r = 0; r < ti->tree_nodes; ++r)
+    ti->tasks[ti->tree_order[r]].prefetch = 1;
+  task_prefetch_marked(ti, sources);
+  totals = arena_alloc(&ti->arena, ti->ntasks * sizeof *totals);
+  for(r = 0; r < ti->tree_nodes; ++r) {
+    n = ti->tree_order[r];
+    totals[n] = get(ti, ti->tasks[n].taskid);
+  }
+  for(r = ti->tree_nodes; r > 0; --r) {
+    n = ti->tree_order[r - 1];
+    p = ti->tree_parent[n];
+    if(p != SIZE_MAX && ti->tree_rank[p] < r - 1)
+      totals[p] += totals[n];
+  }
+  /* Threads report their process's total */
+  for(n = 0; n < ti->ntasks; ++n)
+    totals[n] = totals[ti->tree_order[ti->tree_rank[n]]];
+  return *totalsp = totals;
+}
+
+static double tree_get_rss(struct taskinfo *ti, taskident taskid) {
+  return task_get_rss(ti, taskid);
+}
+
+static double tree_get_pss(struct taskinfo *ti, taskident taskid) {
+  return task_get_pss(ti, taskid);
+}
+
+double task_get_tree_pcpu(struct taskinfo *ti, taskident taskid) {
+  size_t n = taskindex_find(&ti->index, taskid);
+  if(n == SIZE_MAX)
+    return 0;
+  return task_tree_total(ti, &ti->tree_pcpu, TASK_SRC_STAT,
+                         task_get_pcpu)[n];
+}
+
+double task_get_tree_rw_bytes(struct taskinfo *ti, taskident taskid) {
+  size_t n = taskindex_find(&ti->index, taskid);
+  if(n == SIZE_MAX)
+    return 0;
+  return task_tree_total(ti, &ti->tree_io, TASK_SRC_IO,
+                         task_get_rw_bytes)[n];
+}
+
+uintmax_t task_get_tree_rss(struct taskinfo *ti, taskident taskid) {
+  size_t n = taskindex_find(&ti->index, taskid);
+  if(n == SIZE_MAX)
+    return 0;
+  return task_tree_total(ti, &ti->tree_rss, TASK_SRC_STAT,
+                         tree_get_rss)[n];
+}
+
+uintmax_t task_get_tree_pss(struct taskinfo *ti, taskident taskid) {
+  size_t n = taskindex_find(&ti->index, taskid);
+  if(n == SIZE_MAX)
+    return 0;
+  return task_tree_total(ti, &ti->tree_pss, TASK_SRC_SMAPS,
+                         tree_get_pss)[n];
 }
 
 // ----------------------------------------------------------------------------
@@ -36,6 +36,18 @@ extern const char *proc;
 /** @brief PID to pretend to */
 extern pid_t selfpid;
 
+/** @brief Number of threads to use for enumeration
+ *
+ * 0 means to choose automatically based on the number of tasks.
+ */
+extern unsigned task_workers;
+
+/** @brief Use @c smaps_rollup where available
+ *
+ * If this is 0 then PSS and swap are always computed from @c smaps.
+ */
+extern int task_smaps_rollup;
+
 /** @brief Identifier for a process or thread */
 typedef struct {
   /** @brief Process ID */
@@ -50,6 +62,12 @@ typedef struct {
 /** @brief Enumerate processes */
 #define TASK_PROCESSES 0x0002
 
+/** @brief Track tasks using process events where possible */
+#define TASK_EVENTS 0x0004
+
+/** @brief Only enumerate processes that might be selected */
+#define TASK_SELECTED 0x0008
+
 /** @brief (Re-)enumerate all processes or threads
  * @param last Previous task list or NULL
  * @param flags Flags
@@ -60,12 +78,30 @@ typedef struct {
  * @p flags should be a combination of:
  * - @ref TASK_THREADS to retrieve information about threads
  * - @ref TASK_PROCESSES (ignored)
+ * - @ref TASK_EVENTS to avoid rescanning /proc
+ * - @ref TASK_SELECTED to skip processes that can't be selected
  *
  * Processes are always enumerated.
+ *
+ * With @ref TASK_EVENTS, the first call scans /proc as normal and
+ * subscribes to process events; subsequent calls use the events to
+ * keep track of which tasks exist.  If events are not available then
+ * every call scans /proc.
+ *
+ * With @ref TASK_SELECTED, selectors that can identify candidate
+ * processes without reading all of /proc (see select_candidates())
+ * are used to limit enumeration.  Only use this if nothing will ask
+ * about unselected tasks, for instance the parent of a selected task.
+ * It has no effect in combination with @ref TASK_EVENTS.
  */
 struct taskinfo *task_enumerate(struct taskinfo *last,
                                 unsigned flags);
 
+/** @brief Test whether process events are in use
+ * @return Nonzero if @ref TASK_EVENTS is effective
+ */
+int task_events(void);
+
 /** @brief Re-run task selection
  *
  * task_enumerate() does this automatically, but if you change the
@@ -77,6 +113,54 @@ void task_reselect(struct taskinfo *ti);
  */
 void task_free(struct taskinfo *ti);
 
+/** @brief Source for properties in @c /proc/PID/stat */
+#define TASK_SRC_STAT 0x0001
+
+/** @brief Source for user and group IDs in @c /proc/PID/status */
+#define TASK_SRC_STATUS_IDS 0x0002
+
+/** @brief Source for supplementary groups in @c /proc/PID/status */
+#define TASK_SRC_STATUS_GROUPS 0x0040
+
+/** @brief Source for memory usage in @c /proc/PID/status */
+#define TASK_SRC_STATUS_VM 0x0080
+
+/** @brief Source for signal sets in @c /proc/PID/status */
+#define TASK_SRC_STATUS_SIGNALS 0x0100
+
+/** @brief Source for all properties in @c /proc/PID/status
+ *
+ * Only the parts of the file that were asked for are parsed.
+ */
+#define TASK_SRC_STATUS (TASK_SRC_STATUS_IDS|TASK_SRC_STATUS_GROUPS \
+                         |TASK_SRC_STATUS_VM|TASK_SRC_STATUS_SIGNALS)
+
+/** @brief Source for properties in @c /proc/PID/cmdline */
+#define TASK_SRC_CMDLINE 0x0004
+
+/** @brief Source for properties in @c /proc/PID/io */
+#define TASK_SRC_IO 0x0008
+
+/** @brief Source for properties in @c /proc/PID/smaps */
+#define TASK_SRC_SMAPS 0x0010
+
+/** @brief Source for properties in @c /proc/PID/oom_score */
+#define TASK_SRC_OOM 0x0020
+
+/** @brief Load task properties in bulk
+ * @param ti Pointer to task information
+ * @param tasks Tasks to load
+ * @param ntasks Number of tasks
+ * @param sources Bitmap of sources to load
+ *
+ * @p sources is a combination of @ref TASK_SRC_STAT etc.  All of the
+ * requested sources are read for all of the listed tasks, using
+ * multiple threads if @ref task_workers allows.  Properties not
+ * loaded in advance are still loaded on demand.
+ */
+void task_prefetch(struct taskinfo *ti, const taskident *tasks,
+                   size_t ntasks, unsigned sources);
+
 /** @brief Count the number of processes
  * @param ti Pointer to task information
  * @return Number of processes
@@ -397,6 +481,17 @@ double task_get_minflt(struct taskinfo *ti, taskident taskid);
  */
 int task_get_depth(struct taskinfo *ti, taskident taskid);
 
+/** @brief Retrieve position of process in hierarchy
+ * @param ti Pointer to task information
+ * @param taskid Process or thread ID
+ * @return Position in a depth-first traversal of the process tree
+ *
+ * Each process comes after its parent and before its parent's next
+ * sibling; siblings are ordered by PID.  Threads share their
+ * process's position.  Unknown tasks return @c SIZE_MAX.
+ */
+size_t task_get_tree_rank(struct taskinfo *ti, taskident taskid);
+
 /** @brief Retrieve PSS
  * @param ti Pointer to task information
  * @param taskid Process or thread ID
@@ -529,6 +624,38 @@ uintmax_t task_get_pte(struct taskinfo *ti, taskident taskid);
 
 // ----------------------------------------------------------------------------
 
+/** @brief Retrieve %CPU of a process and its descendants
+ * @param ti Pointer to task information
+ * @param taskid Process or thread ID
+ * @return Sum of task_get_pcpu() over the process's subtree
+ *
+ * Threads report the total for their process.  Like the other tree
+ * totals, this is computed for every process at once, the first
+ * time it is needed.
+ */
+double task_get_tree_pcpu(struct taskinfo *ti, taskident taskid);
+
+/** @brief Retrieve read+write rate of a process and its descendants
+ * @param ti Pointer to task information
+ * @param taskid Process or thread ID
+ * @return Sum of task_get_rw_bytes() over the process's subtree
+ */
+double task_get_tree_rw_bytes(struct taskinfo *ti, taskident taskid);
+
+/** @brief Retrieve RSS of a process and its descendants
+ * @param ti Pointer to task information
+ * @param taskid Process or thread ID
+ * @return Sum of task_get_rss() over the process's subtree
+ */
+uintmax_t task_get_tree_rss(struct taskinfo *ti, taskident taskid);
+
+/** @brief Retrieve PSS of a process and its descendants
+ * @param ti Pointer to task information
+ * @param taskid Process or thread ID
+ * @return Sum of task_get_pss() over the process's subtree
+ */
+uintmax_t task_get_tree_pss(struct taskinfo *ti, taskident taskid);
+
 /** @brief Return true if @p a is an ancestor of, or equal to, @p b
  * @param ti Pointer to task information
  * @param a Process or thread ID
@@ -536,6 +663,8 @@ uintmax_t task_get_pte(struct taskinfo *ti, taskident taskid);
  * @return Nonzero iff @p a is an ancestor of, or equal to, @p b
  *
  * Ancestry applies to whole processes; thread IDs are disregarded.
+ * After the process tree has been built (which happens on first use)
+ * this takes constant time.
  */
 int task_is_ancestor(struct taskinfo *ti, taskident a, taskident b);
 
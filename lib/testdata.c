@@ -0,0 +1,57 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#include <config.h>
+#include "testdata.h"
+#include "selectors.h"
+#include "utils.h"
+#include <assert.h>
+#include <stdlib.h>
+
+static char *snapshot;
+
+char *testdata_path(const char *name) {
+  const char *srcdir;
+  char *path;
+
+  if(!(srcdir = getenv("srcdir")))
+    srcdir = ".";
+  xasprintf(&path, "%s/../src/testdata/%s", srcdir, name);
+  return path;
+}
+
+struct taskinfo *testdata_tasks(unsigned flags,
+                                taskident **tasksp, size_t *ntasksp) {
+  struct taskinfo *ti;
+
+  if(!snapshot)
+    snapshot = testdata_path("0");
+  proc = snapshot;
+  select_add(select_all, NULL, 0);
+  ti = task_enumerate(NULL, flags);
+  *tasksp = task_get_selected(ti, ntasksp, flags);
+  assert(*ntasksp > 0);
+  return ti;
+}
+
+void testdata_free(struct taskinfo *ti, taskident *tasks) {
+  free(tasks);
+  task_free(ti);
+  select_clear();
+}
@@ -0,0 +1,55 @@
+/*
+ * This file is part of nps.
+ * Copyright (C) 2026 Richard Kettlewell
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+#ifndef TESTDATA_H
+#define TESTDATA_H
+
+/** @file testdata.h
+ * @brief Access to the /proc snapshot used by tests
+ */
+
+#include "tasks.h"
+
+/** @brief Path to a file in the test data directory
+ * @param name Path relative to src/testdata
+ * @return Full path, which the caller should free
+ */
+char *testdata_path(const char *name);
+
+/** @brief Enumerate every task in the /proc snapshot
+ * @param flags Combination of @ref TASK_PROCESSES and @ref TASK_THREADS
+ * @param tasksp Where to store the tasks; owned by caller
+ * @param ntasksp Where to store the number of tasks
+ * @return Pointer to task information
+ *
+ * Sets @ref proc to the snapshot and registers a selector that
+ * matches everything.  There is always at least one task.
+ */
+struct taskinfo *testdata_tasks(unsigned flags,
+                                taskident **tasksp, size_t *ntasksp);
+
+/** @brief Free the results of testdata_tasks()
+ * @param ti Pointer to task information
+ * @param tasks Tasks
+ *
+ * Also clears all selectors.
+ */
+void testdata_free(struct taskinfo *ti, taskident *tasks);
+
+#endif /* TESTDATA_H */
@@ -28,6 +28,7 @@
 #include "buffer.h"
 #include "io.h"
 #include "user.h"
+#include "parallel.h"
 #include <getopt.h>
 #include <errno.h>
 #include <termios.h>
@@ -60,6 +61,8 @@ enum {
   OPT_SET_GROUPS,
   OPT_SET_DEV,
   OPT_SET_UID,
+  OPT_WORKERS,
+  OPT_FILTER,
 };
 
 const struct option options[] = {
@@ -95,6 +98,8 @@ const struct option options[] = {
   { "set-uid", required_argument, 0, OPT_SET_UID },
   { "help-match", no_argument, 0, OPT_HELP_MATCH },
   { "version", no_argument, 0, OPT_VERSION },
+  { "workers", required_argument, 0, OPT_WORKERS },
+  { "filter", required_argument, 0, OPT_FILTER },
   { 0, 0, 0, 0 },
 };
 
@@ -116,6 +121,7 @@ int main(int argc, char **argv) {
   double update_interval = 0;
   long poll_count = -1;
   const char *proc2 = NULL;
+  unsigned enumerate_flags;
 
   /* Initialize privilege support (this must stay first) */
   priv_init(argc, argv);
@@ -262,6 +268,12 @@ int main(int argc, char **argv) {
         fatal(0, "excess privilege");
       forceuid = atoi(optarg);
       break;
+    case OPT_WORKERS:
+      task_workers = parse_workers(optarg);
+      break;
+    case OPT_FILTER:
+      select_filter(optarg);
+      break;
     case OPT_HELP:
       xprintf("Usage:\n"
              "  ps [OPTIONS] [MATCH|PIDS...]\n"
@@ -272,6 +284,7 @@ int main(int argc, char **argv) {
              "  -C, --command NAME      Select by process name\n"
              "  --csv                   CSV-format output\n"
              "  -d                      Select non-session-leaders\n"
+             "  --filter EXPR           Only show processes matching EXPR; see --help-match\n"
              "  -f, --full, -l, --long  Full/long output format\n"
              "  -g SIDS                 Select processes by session ID\n"
              "  -G GIDS, --group GIDS   Select processes by real/effective group ID\n"
@@ -285,6 +298,7 @@ int main(int argc, char **argv) {
              "  -t, --tty TERMS         Select processes by terminal\n"
              "  -u, -U UIDS             Select processes by real/effective user ID\n"
              "  -w                      Don't truncate output\n"
+             "  --workers N             Number of threads to scan /proc with\n"
              "  --help                  Display option summary\n"
              "  --version               Display version string\n"
              "See also --help-format, --help-match.\n");
@@ -322,7 +336,10 @@ int main(int argc, char **argv) {
              "  PROP==VALUE    Equal value\n"
              "  PROP<>VALUE    Different value\n"
              "\n"
-             "Put a ':' after the operator to avoid confusion with first character of VALUE.\n");
+             "Put a ':' after the operator to avoid confusion with first character of VALUE.\n"
+             "\n"
+             "With --filter, match expressions can be combined using 'and', 'or', 'not'\n"
+             "and parentheses.  Quote match expressions that contain spaces or parentheses.\n");
       xexit(0);
     case OPT_VERSION:
       xprintf("%s\n", PACKAGE_VERSION);
@@ -372,8 +389,13 @@ int main(int argc, char **argv) {
   }
   /* Set the default selection */
   select_default(select_uid_tty, NULL, 0);
+  /* Only look at the tasks that might be selected, if nothing else
+   * is needed */
+  enumerate_flags = procflags;
+  if(!format_global())
+    enumerate_flags |= TASK_SELECTED;
   /* Get the list of tasks */
-  global_taskinfo = task_enumerate(NULL, procflags);
+  global_taskinfo = task_enumerate(NULL, enumerate_flags);
   if(format_rate(global_taskinfo, procflags)) {
     usleep(sample_interval);
     p = global_taskinfo;
@@ -381,7 +403,7 @@ int main(int argc, char **argv) {
       proc = proc2;
     if(forcetime.tv_sec)
       forcetime.tv_nsec = sample_interval * 1000;
-    global_taskinfo = task_enumerate(p, procflags);
+    global_taskinfo = task_enumerate(p, enumerate_flags);
     task_free(p);
   }
   if(update_interval) {
@@ -400,7 +422,7 @@ int main(int argc, char **argv) {
       if(rc < 0)
         fatal(errno, "nanosleep");
       p = global_taskinfo;
-      global_taskinfo = task_enumerate(p, procflags);
+      global_taskinfo = task_enumerate(p, enumerate_flags);
       task_free(p);
       first = 0;
     }
@@ -419,9 +441,11 @@ static void report(int first) {
   int n;
 
   tasks = task_get_selected(global_taskinfo, &ntasks, procflags);
+  /* Load everything the output will need in one go */
+  task_prefetch(global_taskinfo, tasks, ntasks, format_sources());
   /* Put them into order */
   if(sorting)
-    qsort(tasks, ntasks, sizeof *tasks, compare_task);
+    format_sort(global_taskinfo, tasks, ntasks);
   /* Set up output formatting */
   format_columns(global_taskinfo, tasks, ntasks);
   buffer_init(b);
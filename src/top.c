@@ -29,6 +29,7 @@
 #include "priv.h"
 #include "buffer.h"
 #include "io.h"
+#include "parallel.h"
 #include <getopt.h>
 #include <curses.h>
 #include <locale.h>
@@ -49,6 +50,9 @@ enum {
   OPT_HELP_FORMAT,
   OPT_HELP_SYSINFO,
   OPT_VERSION,
+  OPT_WORKERS,
+  OPT_EVENTS,
+  OPT_FILTER,
 };
 
 const struct option options[] = {
@@ -62,6 +66,9 @@ const struct option options[] = {
   { "help-format", no_argument, 0, OPT_HELP_FORMAT },
   { "help-sysinfo", no_argument, 0, OPT_HELP_SYSINFO },
   { "version", no_argument, 0, OPT_VERSION },
+  { "workers", required_argument, 0, OPT_WORKERS },
+  { "events", no_argument, 0, OPT_EVENTS },
+  { "filter", required_argument, 0, OPT_FILTER },
   { 0, 0, 0, 0 },
 };
 
@@ -132,6 +139,9 @@ static double update_last;
 /** @brief Whether to show idle processes */
 static int show_idle = 1;
 
+/** @brief Flags for task_enumerate() */
+static unsigned enumerate_flags = TASK_PROCESSES|TASK_THREADS;
+
 /** @brief Keypress handler 
  *
  * Usually this is process_command() but it switches to
@@ -260,16 +270,28 @@ int main(int argc, char **argv) {
     case 'd':
       update_interval = parse_interval(optarg);
       break;
+    case OPT_WORKERS:
+      task_workers = parse_workers(optarg);
+      break;
+    case OPT_EVENTS:
+      enumerate_flags |= TASK_EVENTS;
+      break;
+    case OPT_FILTER:
+      select_filter(optarg);
+      break;
     case OPT_HELP:
       xprintf("Usage:\n"
              "  top [OPTIONS]\n"
              "Options:\n"
              "  -d, --delay SECONDS        Set update interval\n"
+             "  --events                   Track processes with kernel events\n"
+             "  --filter EXPR              Only show processes matching EXPR\n"
              "  -i, --idle                 Hide idle processes\n"
              "  -L, --threads              Display threads\n"
              "  -j, --sysinfo SYSPROPS...  Set system information format; see --help-sysinfo\n"
              "  -o, -O, --format PROPS...  Set output format; see --help-format\n"
              "  -s, --sort [+/-]PROPS...   Set ordering; see --help-format\n"
+             "  --workers N                Number of threads to scan /proc with\n"
              "  --help                     Display option summary\n"
              "  --version                  Display version string\n"
              "Press 'h' for on-screen help.\n");
@@ -415,7 +437,7 @@ static void loop(void) {
   struct taskinfo *last = NULL;
   char *ptr, *newline;
   int x, y, maxx, maxy, ystart = 0, ylimit;
-  size_t n, ntasks, len, offset;
+  size_t n, ntasks, nsorted = 0, nmeasured = 0, len, offset;
   taskident *tasks = NULL;
   enum next_action next = NEXT_RESAMPLE;
   const struct help_page *help;
@@ -428,12 +450,12 @@ static void loop(void) {
       task_free(last);
       last = global_taskinfo;
       update_last = clock_now();
-      global_taskinfo = task_enumerate(last, TASK_PROCESSES|TASK_THREADS);
+      global_taskinfo = task_enumerate(last, enumerate_flags);
       if(last == NULL
          && format_rate(global_taskinfo, TASK_PROCESSES|TASK_THREADS)) {
         usleep(100 * 1000);
         last = global_taskinfo;
-        global_taskinfo = task_enumerate(last, TASK_PROCESSES|TASK_THREADS);
+        global_taskinfo = task_enumerate(last, enumerate_flags);
       }
       sysinfo_reset();
       free(tasks);
@@ -450,13 +472,23 @@ static void loop(void) {
       next |= NEXT_RESORT|NEXT_REFORMAT;
     }
     if(next & NEXT_RESORT) {
-      /* Put tasks into order */
-      qsort(tasks, ntasks, sizeof *tasks, compare_task);
+      /* Put tasks into order.  Only those that fit on the screen will
+       * be displayed, so only they need sorting; but every task needs
+       * what the ordering looks at. */
+      task_prefetch(global_taskinfo, tasks, ntasks, format_order_sources());
+      nsorted = format_select(global_taskinfo, tasks, ntasks, LINES);
       next |= NEXT_REDRAW;
     }
+    if(next & (NEXT_RESORT|NEXT_REFORMAT))
+      /* Load what the columns need, for the tasks that can be
+       * displayed */
+      task_prefetch(global_taskinfo, tasks, min(ntasks, (size_t)LINES),
+                    format_column_sources());
     if(next & NEXT_REFORMAT) {
-      /* Work out column widths */
-      format_columns(global_taskinfo, tasks, ntasks);
+      /* Work out column widths.  Only the tasks that fit on the
+       * screen are displayed, so only they are measured. */
+      nmeasured = min(ntasks, (size_t)LINES);
+      format_columns(global_taskinfo, tasks, nmeasured);
       next |= NEXT_REDRAW;
     }
     if(next & NEXT_RESYSINFO) {
@@ -502,6 +534,16 @@ static void loop(void) {
       ylimit = maxy - min(help->nlines, 8);
       move(ystart, 0);
       clrtobot();
+      if(nmeasured < min(ntasks, (size_t)LINES)) {
+        /* The screen got bigger since the tasks were sorted and
+         * measured */
+        nmeasured = min(ntasks, (size_t)LINES);
+        if(nsorted < nmeasured)
+          nsorted = format_select(global_taskinfo, tasks, ntasks, nmeasured);
+        task_prefetch(global_taskinfo, tasks, nmeasured,
+                      format_column_sources());
+        format_columns(global_taskinfo, tasks, nmeasured);
+      }
 
       /* Heading */
       if(y < ylimit) {